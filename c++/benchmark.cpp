@@ -0,0 +1,1229 @@
+/// Copyright (c) 2021 Pavel Kirienko <pavel@uavcan.org>
+///
+/// Performance benchmarks. Build with optimizations for meaningful results, e.g., -DCMAKE_BUILD_TYPE=Release.
+/// Usage: benchmark_cpp [--repetitions=N] [--json=FILE] [filter [scale]]
+/// Only the scenarios whose name contains the filter substring are executed (all by default).
+/// The scale is a real multiplier applied to the problem sizes (1 by default).
+/// All selected scenarios are executed N times in a row (once by default); if a JSON file is given, every measurement
+/// is written there upon completion for later comparison with tools/bench_compare.cpp.
+
+#include "cavl.hpp"
+#include "cavl_concurrent.hpp"
+#include "cavl_containers.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace
+{
+class Item final : public cavl::Node<Item>
+{
+public:
+    explicit Item(const std::uint64_t k) : key(k) {}
+    using Self = cavl::Node<Item>;
+    using Self::getChildNode;
+    using Self::getNextInOrderNode;
+    using Self::search;
+
+    std::uint64_t key;
+};
+using ItemTree = cavl::Tree<Item>;
+
+auto compareKeys(const std::uint64_t a, const std::uint64_t b) -> int
+{
+    return (a < b) ? -1 : ((a > b) ? +1 : 0);
+}
+
+struct Options final
+{
+    std::string filter;
+    double      scale = 1.0;
+
+    auto enabled(const std::string& scenario) const -> bool { return scenario.find(filter) != std::string::npos; }
+    auto scaled(const std::size_t x) const -> std::size_t
+    {
+        return std::max<std::size_t>(1U, static_cast<std::size_t>(static_cast<double>(x) * scale));
+    }
+};
+
+/// The measurements of one variant of a scenario across all repetitions, in the order of reporting.
+struct Result final
+{
+    std::string         scenario;
+    std::string         variant;
+    std::string         params;
+    std::vector<double> ns_per_op;
+};
+
+auto getResults() -> std::vector<Result>&
+{
+    static std::vector<Result> results;
+    return results;
+}
+
+void report(const std::string& scenario, const std::string& variant, const std::string& params, const double ns_per_op)
+{
+    std::printf("%-24s %-24s %-32s %12.2f ns/op\n", scenario.c_str(), variant.c_str(), params.c_str(), ns_per_op);
+    (void) std::fflush(stdout);
+    auto&      results = getResults();
+    const auto it      = std::find_if(results.begin(), results.end(), [&](const Result& x) {
+        return (x.scenario == scenario) && (x.variant == variant) && (x.params == params);
+    });
+    if (it != results.end())
+    {
+        it->ns_per_op.push_back(ns_per_op);
+    }
+    else
+    {
+        results.push_back({scenario, variant, params, {ns_per_op}});
+    }
+}
+
+/// Memory footprints are deterministic, so they are printed for reference but not recorded with the timings.
+void reportMemory(const std::string& scenario,
+                  const std::string& variant,
+                  const std::string& params,
+                  const std::size_t  bytes,
+                  const std::size_t  per)
+{
+    std::printf("%-24s %-24s %-32s %12.2f bytes/set\n",
+                scenario.c_str(),
+                variant.c_str(),
+                params.c_str(),
+                static_cast<double>(bytes) / static_cast<double>(per));
+    (void) std::fflush(stdout);
+}
+
+auto escapeJSON(const std::string& str) -> std::string
+{
+    std::string out;
+    for (const char c : str)
+    {
+        if ((c == '"') || (c == '\\'))
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20U)
+        {
+            std::array<char, 8> buf{};
+            (void) std::snprintf(buf.data(), buf.size(), "\\u%04x", static_cast<unsigned>(c));
+            out += buf.data();
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    return out;
+}
+
+auto writeJSON(const std::string& path, const Options& opt, const std::size_t repetitions) -> bool
+{
+    std::FILE* const file = std::fopen(path.c_str(), "w");  // NOLINT(*-owning-memory)
+    if (file == nullptr)
+    {
+        return false;
+    }
+    (void) std::fprintf(file,
+                        "{\n  \"scale\": %g,\n  \"repetitions\": %zu,\n  \"results\": [",
+                        opt.scale,
+                        repetitions);
+    const auto& results = getResults();
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+        const Result& r = results.at(i);
+        (void) std::fprintf(file,
+                            "%s\n    {\"scenario\": \"%s\", \"variant\": \"%s\", \"params\": \"%s\", \"ns_per_op\": [",
+                            (i > 0U) ? "," : "",
+                            escapeJSON(r.scenario).c_str(),
+                            escapeJSON(r.variant).c_str(),
+                            escapeJSON(r.params).c_str());
+        for (std::size_t k = 0; k < r.ns_per_op.size(); k++)
+        {
+            (void) std::fprintf(file, "%s%.4f", (k > 0U) ? ", " : "", r.ns_per_op.at(k));
+        }
+        (void) std::fprintf(file, "]}");
+    }
+    (void) std::fprintf(file, "\n  ]\n}\n");
+    const bool ok = std::ferror(file) == 0;
+    return (std::fclose(file) == 0) && ok;  // NOLINT(*-owning-memory)
+}
+
+/// Prevents the compiler from eliding the computation of the value.
+void consume(const std::size_t value)
+{
+    static volatile std::size_t sink = 0;
+    sink                             = sink + value;
+}
+
+/// Runs the function once and returns the elapsed wall time divided by the number of operations.
+template <typename F>
+auto measure(const std::size_t ops, const F& fn) -> double
+{
+    const auto started = std::chrono::steady_clock::now();
+    fn();
+    const auto elapsed = std::chrono::steady_clock::now() - started;
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) /
+           static_cast<double>(std::max<std::size_t>(1U, ops));
+}
+
+/// Starts the specified number of threads invoking fn(thread_index) simultaneously and waits for all of them.
+template <typename F>
+void runParallel(const std::size_t threads, const F& fn)
+{
+    std::atomic<std::size_t> ready{0};
+    std::vector<std::thread> pool;
+    for (std::size_t i = 0; i < threads; i++)
+    {
+        pool.emplace_back([&, i] {
+            ready++;
+            while (ready.load() < threads)
+            {
+                std::this_thread::yield();
+            }
+            fn(i);
+        });
+    }
+    for (auto& t : pool)
+    {
+        t.join();
+    }
+}
+
+auto makeKeys(const std::size_t count, const std::uint64_t seed) -> std::vector<std::uint64_t>
+{
+    std::mt19937_64            rng(seed);
+    std::vector<std::uint64_t> out(count);
+    std::generate(out.begin(), out.end(), rng);
+    return out;
+}
+
+auto getThreadCounts() -> std::vector<std::size_t>
+{
+    const std::size_t        max = std::max(1U, std::thread::hardware_concurrency());
+    std::vector<std::size_t> out;
+    for (std::size_t t = 1; t < max; t *= 2U)
+    {
+        out.push_back(t);
+    }
+    out.push_back(max);
+    return out;
+}
+
+/// Concurrent lookups in one shared tree guarded by a reader-writer lock versus per-thread replicas.
+void benchmarkReplicatedReads(const Options& opt)
+{
+    const std::size_t n       = opt.scaled(1'000'000);
+    const std::size_t lookups = opt.scaled(1'000'000);
+    const auto        keys    = makeKeys(n, 1);
+    for (const std::size_t threads : getThreadCounts())
+    {
+        const std::string params = "n=" + std::to_string(n) + " threads=" + std::to_string(threads);
+        {
+            std::vector<std::unique_ptr<Item>> items;
+            ItemTree                           tree;
+            for (const auto k : keys)
+            {
+                (void) tree.search([k](const Item& x) { return compareKeys(k, x.key); },
+                                   [&] {
+                                       items.push_back(std::make_unique<Item>(k));
+                                       return items.back().get();
+                                   });
+            }
+            std::shared_mutex mutex;
+            std::atomic<int>  sink{0};
+            const double      ns = measure(lookups * threads, [&] {
+                runParallel(threads, [&](const std::size_t index) {
+                    int hits = 0;
+                    for (std::size_t i = 0; i < lookups; i++)
+                    {
+                        const auto                                k = keys[(i * 7919U + index) % n];
+                        const std::shared_lock<std::shared_mutex> lock(mutex);
+                        hits += (nullptr != tree.search([k](const Item& x) { return compareKeys(k, x.key); })) ? 1 : 0;
+                    }
+                    sink += hits;
+                });
+            });
+            report("replicated_reads", "shared_tree", params, ns);
+        }
+        {
+            cavl::Replicated<std::uint64_t> set(threads);
+            for (const auto k : keys)
+            {
+                (void) set.insert(k);
+            }
+            set.synchronize();
+            std::atomic<int> sink{0};
+            const double     ns = measure(lookups * threads, [&] {
+                runParallel(threads, [&](const std::size_t index) {
+                    int hits = 0;
+                    for (std::size_t i = 0; i < lookups; i++)
+                    {
+                        const auto k = keys[(i * 7919U + index) % n];
+                        hits += set.contains(index, [k](const std::uint64_t x) { return compareKeys(k, x); }) ? 1 : 0;
+                    }
+                    sink += hits;
+                });
+            });
+            report("replicated_reads", "replicated", params, ns);
+        }
+    }
+}
+
+class Spinlock final
+{
+public:
+    void lock() noexcept
+    {
+        while (flag_.test_and_set(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+    }
+    void unlock() noexcept { flag_.clear(std::memory_order_release); }
+
+private:
+    std::atomic_flag flag_ = ATOMIC_FLAG_INIT;
+};
+
+/// The baseline for the concurrent containers: a plain tree of heap-allocated items guarded by a single lock.
+template <typename Lock>
+class LockedSet final
+{
+public:
+    LockedSet()                            = default;
+    LockedSet(const LockedSet&)            = delete;
+    LockedSet(LockedSet&&)                 = delete;
+    LockedSet& operator=(const LockedSet&) = delete;
+    LockedSet& operator=(LockedSet&&)      = delete;
+    ~LockedSet()
+    {
+        tree_.reclaim([](Item& x) { delete &x; });  // NOLINT(*-owning-memory)
+    }
+
+    auto insert(const std::uint64_t key) -> bool
+    {
+        const std::lock_guard<Lock> lock(lock_);
+        return !std::get<1>(tree_.search([key](const Item& x) { return compareKeys(key, x.key); },
+                                         [key] { return new Item(key); }));  // NOLINT(*-owning-memory)
+    }
+    auto remove(const std::uint64_t key) -> bool
+    {
+        const std::lock_guard<Lock> lock(lock_);
+        Item* const                 item = tree_.search([key](const Item& x) { return compareKeys(key, x.key); });
+        if (item != nullptr)
+        {
+            tree_.remove(item);
+            delete item;  // NOLINT(*-owning-memory)
+        }
+        return item != nullptr;
+    }
+    /// Lookups share the lock with each other if the lock supports that.
+    auto contains(const std::uint64_t key) -> bool
+    {
+        if constexpr (std::is_same_v<Lock, std::shared_mutex>)
+        {
+            const std::shared_lock<Lock> lock(lock_);
+            return nullptr != tree_.search([key](const Item& x) { return compareKeys(key, x.key); });
+        }
+        else
+        {
+            const std::lock_guard<Lock> lock(lock_);
+            return nullptr != tree_.search([key](const Item& x) { return compareKeys(key, x.key); });
+        }
+    }
+
+private:
+    Lock     lock_;
+    ItemTree tree_;
+};
+
+/// Mixed insert/remove/lookup workload on a contended set: flat combining versus a mutex and a spinlock.
+void benchmarkFlatCombining(const Options& opt)
+{
+    const std::size_t n   = opt.scaled(100'000);
+    const std::size_t ops = opt.scaled(100'000);
+    const auto        run = [&](const std::string& variant, const std::size_t threads, const auto& op) {
+        const double ns = measure(ops * threads, [&] {
+            runParallel(threads, [&](const std::size_t index) {
+                std::mt19937_64 rng(index);
+                for (std::size_t i = 0; i < ops; i++)
+                {
+                    const std::uint64_t r = rng();
+                    op(index, (r >> 2U) % (2U * n), r % 4U);  // Half of the operations are lookups.
+                }
+            });
+        });
+        report("flat_combining", variant, "n=" + std::to_string(n) + " threads=" + std::to_string(threads), ns);
+    };
+    for (const std::size_t threads : {2U, 4U, 8U, 16U, 32U, 64U})
+    {
+        {
+            LockedSet<std::mutex> set;
+            for (std::uint64_t k = 0; k < (2U * n); k += 2U)
+            {
+                (void) set.insert(k);
+            }
+            run("mutex", threads, [&](std::size_t /*index*/, const std::uint64_t key, const std::uint64_t kind) {
+                (void) ((kind == 0U) ? set.insert(key) : ((kind == 1U) ? set.remove(key) : set.contains(key)));
+            });
+        }
+        {
+            LockedSet<Spinlock> set;
+            for (std::uint64_t k = 0; k < (2U * n); k += 2U)
+            {
+                (void) set.insert(k);
+            }
+            run("spinlock", threads, [&](std::size_t /*index*/, const std::uint64_t key, const std::uint64_t kind) {
+                (void) ((kind == 0U) ? set.insert(key) : ((kind == 1U) ? set.remove(key) : set.contains(key)));
+            });
+        }
+        {
+            cavl::FlatCombined<std::uint64_t> set(threads);
+            for (std::uint64_t k = 0; k < (2U * n); k += 2U)
+            {
+                (void) set.insert(0, k);
+            }
+            run("flat_combined", threads, [&](const std::size_t ix, const std::uint64_t key, const std::uint64_t kind) {
+                (void) ((kind == 0U) ? set.insert(ix, key)
+                                     : ((kind == 1U) ? set.remove(ix, key) : set.contains(ix, key)));
+            });
+        }
+    }
+}
+
+void benchmarkDelegation(const Options& opt)
+{
+    const std::size_t n   = opt.scaled(100'000);
+    const std::size_t ops = opt.scaled(100'000);
+    for (const std::uint64_t write_percent : {10U, 50U})
+    {
+        const auto kindOf = [write_percent](const std::uint64_t r) -> std::uint64_t {
+            return ((r % 100U) < write_percent) ? (r % 2U) : 2U;  // 0 -- insert, 1 -- remove, 2 -- lookup.
+        };
+        for (const std::size_t threads : {1U, 2U, 4U, 8U, 16U})
+        {
+            const std::string params = "n=" + std::to_string(n) + " writes=" + std::to_string(write_percent) +
+                                       "% threads=" + std::to_string(threads);
+            {
+                LockedSet<std::shared_mutex> set;
+                for (std::uint64_t k = 0; k < (2U * n); k += 2U)
+                {
+                    (void) set.insert(k);
+                }
+                const double ns = measure(ops * threads, [&] {
+                    runParallel(threads, [&](const std::size_t index) {
+                        std::mt19937_64 rng(index);
+                        for (std::size_t i = 0; i < ops; i++)
+                        {
+                            const std::uint64_t r    = rng();
+                            const std::uint64_t key  = (r >> 8U) % (2U * n);
+                            const std::uint64_t kind = kindOf(r);
+                            (void) ((kind == 0U) ? set.insert(key)
+                                                 : ((kind == 1U) ? set.remove(key) : set.contains(key)));
+                        }
+                    });
+                });
+                report("delegation", "shared_mutex", params, ns);
+            }
+            {
+                cavl::Delegated<std::uint64_t> set(threads, 256);
+                for (std::uint64_t k = 0; k < (2U * n); k += 2U)
+                {
+                    (void) set.insert(0, k);
+                }
+                const double ns = measure(ops * threads, [&] {
+                    runParallel(threads, [&](const std::size_t index) {
+                        std::mt19937_64 rng(index);
+                        for (std::size_t i = 0; i < ops; i++)
+                        {
+                            const std::uint64_t r    = rng();
+                            const std::uint64_t key  = (r >> 8U) % (2U * n);
+                            const std::uint64_t kind = kindOf(r);
+                            if (kind == 2U)
+                            {
+                                (void) set.contains(index, key);
+                            }
+                            else
+                            {
+                                (void) ((kind == 0U) ? set.insert(index, key) : set.remove(index, key));
+                            }
+                        }
+                    });
+                });
+                report("delegation", "delegated_blocking", params, ns);
+            }
+            {
+                // The clients keep up to a full ring of requests in flight and consume the results in the callbacks.
+                cavl::Delegated<std::uint64_t> set(threads, 256);
+                using Op = cavl::Delegated<std::uint64_t>::Op;
+                for (std::uint64_t k = 0; k < (2U * n); k += 2U)
+                {
+                    (void) set.insert(0, k);
+                }
+                std::atomic<std::size_t> hits{0};
+                const double             ns = measure(ops * threads, [&] {
+                    runParallel(threads, [&](const std::size_t index) {
+                        std::mt19937_64          rng(index);
+                        std::atomic<std::size_t> completed{0};
+                        for (std::size_t i = 0; i < ops; i++)
+                        {
+                            const std::uint64_t r    = rng();
+                            const std::uint64_t kind = kindOf(r);
+                            const Op op = (kind == 0U) ? Op::Insert : ((kind == 1U) ? Op::Remove : Op::Contains);
+                            set.submit(index, op, (r >> 8U) % (2U * n), [&](const bool result) {
+                                hits.fetch_add(result ? 1U : 0U, std::memory_order_relaxed);
+                                completed.fetch_add(1U, std::memory_order_release);
+                            });
+                        }
+                        while (completed.load(std::memory_order_acquire) < ops)
+                        {
+                            std::this_thread::yield();
+                        }
+                    });
+                });
+                consume(hits.load());
+                report("delegation", "delegated_async", params, ns);
+            }
+        }
+    }
+}
+
+/// Ingest throughput and lookup latency of the log-structured set versus a single tree.
+void benchmarkLogStructured(const Options& opt)
+{
+    const std::size_t n       = opt.scaled(1'000'000);
+    const std::size_t lookups = opt.scaled(1'000'000);
+    const auto        keys    = makeKeys(n, 2);
+    const std::string params  = "n=" + std::to_string(n);
+    {
+        LockedSet<std::mutex> set;
+        report("log_structured", "tree_ingest", params, measure(n, [&] {
+                   for (const auto k : keys)
+                   {
+                       (void) set.insert(k);
+                   }
+               }));
+        std::size_t hits = 0;
+        report("log_structured", "tree_lookup", params, measure(lookups, [&] {
+                   for (std::size_t i = 0; i < lookups; i++)
+                   {
+                       hits += set.contains(keys[(i * 7919U) % n]) ? 1U : 0U;
+                   }
+               }));
+        consume(hits);
+    }
+    for (const std::size_t buffer : {1024U, 65536U})
+    {
+        const std::string                 variant = "lsm" + std::to_string(buffer);
+        cavl::LogStructured<std::uint64_t> set(buffer);
+        report("log_structured", variant + "_ingest", params, measure(n, [&] {
+                   for (const auto k : keys)
+                   {
+                       set.insert(k);
+                   }
+                   set.flush();
+               }));
+        std::size_t hits = 0;
+        report("log_structured", variant + "_lookup", params, measure(lookups, [&] {
+                   for (std::size_t i = 0; i < lookups; i++)
+                   {
+                       hits += set.contains(keys[(i * 7919U) % n]) ? 1U : 0U;
+                   }
+               }));
+        consume(hits);
+    }
+}
+
+/// Lookups in the auto-freezing set while it is being written (served from the tree under the lock) versus after
+/// the writes went quiet (served from the Eytzinger snapshot without locking).
+void benchmarkAutoFreeze(const Options& opt)
+{
+    const std::size_t n       = opt.scaled(1'000'000);
+    const std::size_t lookups = opt.scaled(1'000'000);
+    const auto        keys    = makeKeys(n, 8);
+    for (const bool frozen : {false, true})
+    {
+        // The quiet period of the thawed variant is long enough to never elapse during the measurement.
+        cavl::AutoFreezing<std::uint64_t> set(frozen ? std::chrono::milliseconds(10) : std::chrono::hours(1));
+        for (const auto k : keys)
+        {
+            (void) set.insert(k);
+        }
+        while (frozen && !set.isFrozen())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        for (const std::size_t threads : getThreadCounts())
+        {
+            const std::string        params = "n=" + std::to_string(n) + " threads=" + std::to_string(threads);
+            std::atomic<std::size_t> hits{0};
+            report("auto_freeze", frozen ? "frozen_lookup" : "thawed_lookup", params, measure(lookups, [&] {
+                       runParallel(threads, [&](const std::size_t t) {
+                           std::size_t local = 0;
+                           for (std::size_t i = t; i < lookups; i += threads)
+                           {
+                               local += set.contains(keys[(i * 7919U) % n]) ? 1U : 0U;
+                           }
+                           hits += local;
+                       });
+                   }));
+            consume(hits.load());
+        }
+    }
+}
+
+/// Lookup of a sorted batch of keys one by one versus the single-pass finger search.
+/// Returns a trace of keys drawn from the Zipfian distribution with the specified exponent; the rank of each key
+/// is assigned randomly, so that the popular keys are scattered across the key space.
+auto makeZipfianTrace(const std::vector<std::uint64_t>& keys, const std::size_t length, const double exponent)
+    -> std::vector<std::uint64_t>
+{
+    std::vector<double> cdf(keys.size());
+    double              sum = 0;
+    for (std::size_t i = 0; i < keys.size(); i++)
+    {
+        sum += 1.0 / std::pow(static_cast<double>(i + 1U), exponent);
+        cdf[i] = sum;
+    }
+    std::mt19937_64                        rng(13);
+    std::uniform_real_distribution<double> uniform(0.0, sum);
+    std::vector<std::uint64_t>             out(length);
+    for (auto& x : out)
+    {
+        const auto pos = std::lower_bound(cdf.begin(), cdf.end(), uniform(rng));
+        x              = keys[std::min(static_cast<std::size_t>(pos - cdf.begin()), keys.size() - 1U)];
+    }
+    return out;
+}
+
+void benchmarkSplay(const Options& opt)
+{
+    const std::size_t n       = opt.scaled(1'000'000);
+    const std::size_t lookups = opt.scaled(2'000'000);
+    const auto        keys    = makeKeys(n, 14);
+    auto              sorted  = keys;
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<std::pair<std::string, std::vector<std::uint64_t>>> traces;
+    {
+        std::vector<std::uint64_t> trace(lookups);
+        std::mt19937_64            rng(15);
+        std::generate(trace.begin(), trace.end(), [&] { return keys[rng() % n]; });
+        traces.emplace_back("uniform", std::move(trace));
+    }
+    traces.emplace_back("zipf_0.99", makeZipfianTrace(keys, lookups, 0.99));
+    traces.emplace_back("zipf_1.2", makeZipfianTrace(keys, lookups, 1.2));
+    {
+        std::vector<std::uint64_t> trace(lookups);
+        for (std::size_t i = 0; i < lookups; i++)
+        {
+            trace[i] = sorted[i % n];
+        }
+        traces.emplace_back("sequential", std::move(trace));
+    }
+    std::vector<Item> avl_items(keys.begin(), keys.end());
+    ItemTree          avl;
+    for (auto& it : avl_items)
+    {
+        (void) avl.search([k = it.key](const Item& x) { return compareKeys(k, x.key); }, [&it] { return &it; });
+    }
+    std::vector<Item>     splay_items(keys.begin(), keys.end());
+    cavl::SplayTree<Item> splay;
+    for (auto& it : splay_items)
+    {
+        (void) splay.search([k = it.key](const Item& x) { return compareKeys(k, x.key); }, [&it] { return &it; });
+    }
+    for (const auto& [name, trace] : traces)
+    {
+        const std::string params = "n=" + std::to_string(n) + " trace=" + name;
+        std::size_t       hits   = 0;
+        report("splay", "avl", params, measure(trace.size(), [&] {
+                   for (const auto k : trace)
+                   {
+                       hits += (avl.search([k](const Item& x) { return compareKeys(k, x.key); }) != nullptr) ? 1U : 0U;
+                   }
+               }));
+        report("splay", "splay", params, measure(trace.size(), [&] {
+                   for (const auto k : trace)
+                   {
+                       const Item* const x = splay.search([k](const Item& v) { return compareKeys(k, v.key); });
+                       hits += (x != nullptr) ? 1U : 0U;
+                   }
+               }));
+        consume(hits);
+    }
+}
+
+void benchmarkPathCached(const Options& opt)
+{
+    const std::size_t        n     = opt.scaled(1'000'000);
+    const auto               keys  = makeKeys(n, 16);
+    const auto               moved = makeKeys(n, 17);
+    std::vector<std::size_t> order(n);
+    std::iota(order.begin(), order.end(), 0U);
+    std::shuffle(order.begin(), order.end(), std::mt19937_64(18));
+    const std::string params = "n=" + std::to_string(n);
+    const auto        pred   = [](const std::uint64_t k) {
+        return [k](const Item& x) { return compareKeys(k, x.key); };
+    };
+    // Every variant empties the tree and fills it back in a random order, then moves every node to a new key.
+    const auto run = [&](const std::string& variant, const auto& remove, const auto& insert, const auto& update) {
+        std::vector<Item> items(keys.begin(), keys.end());
+        ItemTree          tree;
+        for (auto& it : items)
+        {
+            insert(tree, it);
+        }
+        report("path_cached", variant + "_remove", params, measure(n, [&] {
+                   for (const auto i : order)
+                   {
+                       remove(tree, items[i].key);
+                   }
+               }));
+        report("path_cached", variant + "_insert", params, measure(n, [&] {
+                   for (const auto i : order)
+                   {
+                       insert(tree, items[i]);
+                   }
+               }));
+        // Incrementing a random key almost never changes the order, so the nodes can stay in place.
+        report("path_cached", variant + "_update_small", params, measure(n, [&] {
+                   for (const auto i : order)
+                   {
+                       update(tree, items[i].key, items[i].key + 1U);
+                   }
+               }));
+        report("path_cached", variant + "_update_large", params, measure(n, [&] {
+                   for (const auto i : order)
+                   {
+                       update(tree, items[i].key, moved[i]);
+                   }
+               }));
+        consume(tree.empty() ? 0U : 1U);
+    };
+    run(
+        "search",
+        [&](ItemTree& tree, const std::uint64_t k) { tree.remove(tree.search(pred(k))); },
+        [&](ItemTree& tree, Item& item) { (void) tree.search(pred(item.key), [&item] { return &item; }); },
+        [&](ItemTree& tree, const std::uint64_t from, const std::uint64_t to) {
+            Item* const item = tree.search(pred(from));
+            tree.remove(item);
+            item->key = to;
+            (void) tree.search(pred(to), [item] { return item; });
+        });
+    run(
+        "path",
+        [&](ItemTree& tree, const std::uint64_t k) {
+            ItemTree::Path path;
+            if (tree.searchPath(pred(k), path) != nullptr)
+            {
+                tree.removeAt(path);
+            }
+        },
+        [&](ItemTree& tree, Item& item) {
+            ItemTree::Path path;
+            if (tree.searchPath(pred(item.key), path) == nullptr)
+            {
+                tree.insertAt(path, &item);
+            }
+        },
+        [&](ItemTree& tree, const std::uint64_t from, const std::uint64_t to) {
+            ItemTree::Path path;
+            Item* const    item = tree.searchPath(pred(from), path);
+            item->key           = to;
+            (void) tree.reposition(path, pred(to));
+        });
+}
+
+void benchmarkForest(const Options& opt)
+{
+    const std::size_t sets    = opt.scaled(100'000);
+    const std::size_t lookups = opt.scaled(1'000'000);
+    for (const std::size_t per_set : {1U, 4U, 16U})
+    {
+        const std::string params = "sets=" + std::to_string(sets) + " values=" + std::to_string(per_set);
+        const auto        keys   = makeKeys(sets * per_set, 19);
+        // Each probe is a pair of the set index and a key present in that set.
+        std::vector<std::pair<std::size_t, std::uint64_t>> probes(lookups);
+        {
+            std::mt19937_64 rng(20);
+            for (auto& p : probes)
+            {
+                const std::size_t i = rng() % keys.size();
+                p                   = {i / per_set, keys[i]};
+            }
+        }
+        {
+            // The memory estimate excludes the overhead of the heap allocator, which is paid per node.
+            std::vector<ItemTree> trees(sets);
+            for (std::size_t i = 0; i < keys.size(); i++)
+            {
+                const auto k = keys[i];
+                (void) trees[i / per_set].search([k](const Item& x) { return compareKeys(k, x.key); },
+                                                 [k] { return new Item(k); });  // NOLINT(*-owning-memory)
+            }
+            reportMemory("forest",
+                         "tree_objects",
+                         params,
+                         (trees.capacity() * sizeof(ItemTree)) + (keys.size() * sizeof(Item)),
+                         sets);
+            std::size_t hits = 0;
+            report("forest", "tree_objects", params, measure(lookups, [&] {
+                       for (const auto& p : probes)
+                       {
+                           const auto      k    = p.second;
+                           const ItemTree& tree = trees[p.first];
+                           hits += (tree.search([k](const Item& x) { return compareKeys(k, x.key); }) != nullptr) ? 1U
+                                                                                                                  : 0U;
+                       }
+                   }));
+            consume(hits);
+            for (auto& tree : trees)
+            {
+                tree.reclaim([](Item& x) { delete &x; });  // NOLINT(*-owning-memory)
+            }
+        }
+        {
+            cavl::PooledForest<std::uint64_t> forest;
+            forest.reserve(sets);
+            for (std::size_t i = 0; i < sets; i++)
+            {
+                (void) forest.create();
+            }
+            for (std::size_t i = 0; i < keys.size(); i++)
+            {
+                (void) forest.insert(static_cast<std::uint32_t>(i / per_set), keys[i]);
+            }
+            reportMemory("forest", "pooled_forest", params, forest.getMemoryUsage(), sets);
+            std::size_t hits = 0;
+            report("forest", "pooled_forest", params, measure(lookups, [&] {
+                       for (const auto& p : probes)
+                       {
+                           hits += forest.contains(static_cast<std::uint32_t>(p.first), p.second) ? 1U : 0U;
+                       }
+                   }));
+            consume(hits);
+            report("forest", "pooled_forest_clear", params, measure(sets, [&] { forest.clear(); }));
+        }
+    }
+}
+
+void benchmarkSortedSearch(const Options& opt)
+{
+    const std::size_t                  n    = opt.scaled(1'000'000);
+    auto                               keys = makeKeys(n, 3);
+    std::vector<std::unique_ptr<Item>> items;
+    ItemTree                           tree;
+    for (const auto k : keys)
+    {
+        (void) tree.search([k](const Item& x) { return compareKeys(k, x.key); },
+                           [&] {
+                               items.push_back(std::make_unique<Item>(k));
+                               return items.back().get();
+                           });
+    }
+    std::sort(keys.begin(), keys.end());
+    for (const std::size_t stride : {1U, 16U, 1024U})
+    {
+        std::vector<std::uint64_t> batch;
+        for (std::size_t i = 0; i < n; i += stride)
+        {
+            batch.push_back(keys[i]);
+        }
+        const std::string  params = "n=" + std::to_string(n) + " k=" + std::to_string(batch.size());
+        std::vector<Item*> out(batch.size());
+        report("sorted_search", "individual", params, measure(batch.size(), [&] {
+                   for (std::size_t i = 0; i < batch.size(); i++)
+                   {
+                       const auto k = batch[i];
+                       out[i]       = tree.search([k](const Item& x) { return compareKeys(k, x.key); });
+                   }
+               }));
+        consume(static_cast<std::size_t>(out.back() != nullptr));
+        report("sorted_search", "batched", params, measure(batch.size(), [&] {
+                   tree.searchSorted(batch.data(),
+                                     batch.size(),
+                                     [](const std::uint64_t k, const Item& x) { return compareKeys(k, x.key); },
+                                     out.data());
+               }));
+        consume(static_cast<std::size_t>(out.back() != nullptr));
+    }
+}
+
+/// An in-order scan where a second cursor walks the specified number of steps ahead of the visitor and prefetches
+/// the right child of every node it arrives at, so that the cache misses could overlap with the work of the visitor.
+/// This lookahead was evaluated as a library feature and rejected because it was slower than the plain traversal:
+/// every step of either cursor is a chain of dependent loads that prefetching cannot shorten. It is kept here
+/// so that the comparison can be reproduced on other machines.
+template <typename Vis>
+void scanWithLookahead(const ItemTree& tree, const std::size_t distance, const Vis& visitor)
+{
+    const Item* node  = tree.min();
+    const Item* ahead = (distance > 0U) ? node : nullptr;
+    for (std::size_t i = 0; (i < distance) && (ahead != nullptr); i++)
+    {
+        ahead = ahead->getNextInOrderNode();
+    }
+    while (node != nullptr)
+    {
+        if (ahead != nullptr)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(ahead->getChildNode(true));
+#endif
+            ahead = ahead->getNextInOrderNode();
+        }
+        visitor(*node);
+        node = node->getNextInOrderNode();
+    }
+}
+
+/// Full in-order scan of a tree whose nodes are scattered in memory: the library traversal versus the lookahead
+/// prefetching scan at several distances, where distance zero shows the cost of the successor-based walk alone.
+void benchmarkPrefetchScan(const Options& opt)
+{
+    for (const std::size_t size : {1'000'000U, 10'000'000U, 50'000'000U})
+    {
+        const std::size_t n    = opt.scaled(size);
+        const auto        keys = makeKeys(n, 4);
+        std::vector<Item> items;  // The keys are random, so the in-order sequence is scattered across the storage.
+        items.reserve(n);
+        ItemTree tree;
+        for (const auto k : keys)
+        {
+            (void) tree.search([k](const Item& x) { return compareKeys(k, x.key); },
+                               [&] {
+                                   items.emplace_back(k);
+                                   return &items.back();
+                               });
+        }
+        const std::string params = "n=" + std::to_string(n);
+        std::uint64_t     sum    = 0;
+        report("prefetch_scan", "baseline", params, measure(n, [&] {
+                   tree.traverseInOrder([&sum](const Item& x) { sum += x.key; });
+               }));
+        for (const std::size_t distance : {0U, 1U, 4U, 8U, 16U, 32U})
+        {
+            report("prefetch_scan", "distance=" + std::to_string(distance), params, measure(n, [&] {
+                       scanWithLookahead(tree, distance, [&sum](const Item& x) { sum += x.key; });
+                   }));
+        }
+        consume(static_cast<std::size_t>(sum));
+    }
+}
+
+/// Full in-order scan summing the keys, with the visitor invoked per node versus per batch of nodes.
+void benchmarkBatchedScan(const Options& opt)
+{
+    const std::size_t n    = opt.scaled(1'000'000);
+    const auto        keys = makeKeys(n, 5);
+    std::vector<Item> items;
+    items.reserve(n);
+    ItemTree tree;
+    for (const auto k : keys)
+    {
+        (void) tree.search([k](const Item& x) { return compareKeys(k, x.key); },
+                           [&] {
+                               items.emplace_back(k);
+                               return &items.back();
+                           });
+    }
+    const std::string params = "n=" + std::to_string(n);
+    std::uint64_t     sum    = 0;
+    report("batched_scan", "per_node", params, measure(n, [&] {
+               tree.traverseInOrder([&sum](const Item& x) { sum += x.key; });
+           }));
+    report("batched_scan", "batch=64", params, measure(n, [&] {
+               tree.traverseInOrderBatched([&sum](const Item* const* const nodes, const std::size_t count) {
+                   std::uint64_t acc = 0;
+                   for (std::size_t i = 0; i < count; i++)
+                   {
+                       acc += nodes[i]->key;  // NOLINT(*-pointer-arithmetic)
+                   }
+                   sum += acc;
+               });
+           }));
+    consume(static_cast<std::size_t>(sum));
+}
+
+/// Removal of every other node by collecting the pointers during a traversal versus erasing via a cursor.
+void benchmarkPurge(const Options& opt)
+{
+    const std::size_t n    = opt.scaled(1'000'000);
+    const auto        keys = makeKeys(n, 6);
+    const auto        fill = [&](std::vector<Item>& items, ItemTree& tree) {
+        items.clear();
+        items.reserve(n);
+        for (const auto k : keys)
+        {
+            (void) tree.search([k](const Item& x) { return compareKeys(k, x.key); },
+                               [&] {
+                                   items.emplace_back(k);
+                                   return &items.back();
+                               });
+        }
+    };
+    const std::string params = "n=" + std::to_string(n);
+    {
+        std::vector<Item> items;
+        ItemTree          tree;
+        fill(items, tree);
+        report("purge", "collect_then_remove", params, measure(n, [&] {
+                   std::vector<Item*> doomed;
+                   tree.traverseInOrder([&doomed](Item& x) {
+                       if ((x.key % 2U) == 0U)
+                       {
+                           doomed.push_back(&x);
+                       }
+                   });
+                   for (Item* const x : doomed)
+                   {
+                       tree.remove(x);
+                   }
+               }));
+    }
+    {
+        std::vector<Item> items;
+        ItemTree          tree;
+        fill(items, tree);
+        report("purge", "cursor", params, measure(n, [&] {
+                   for (auto cur = tree.getCursor(); cur;)
+                   {
+                       if ((cur.get()->key % 2U) == 0U)
+                       {
+                           (void) cur.erase();
+                       }
+                       else
+                       {
+                           cur.next();
+                       }
+                   }
+               }));
+    }
+}
+
+/// Orthogonal 2-D range queries answered by a range tree versus a linear scan, plus the range tree rebuild cost.
+void benchmarkRangeQuery(const Options& opt)
+{
+    struct Point final
+    {
+        std::uint32_t x;
+        std::uint32_t y;
+    };
+    struct GetX final
+    {
+        auto operator()(const Point& p) const { return p.x; }
+    };
+    struct GetY final
+    {
+        auto operator()(const Point& p) const { return p.y; }
+    };
+    constexpr std::uint32_t Side = std::numeric_limits<std::uint32_t>::max() / 100U;  // 0.01% of the area.
+    for (const std::size_t size : {100'000U, 1'000'000U})
+    {
+        const std::size_t  n       = opt.scaled(size);
+        const std::size_t  queries = opt.scaled(1'000);
+        const auto         keys    = makeKeys(n + queries, 7);
+        std::vector<Point> points(n);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            points.at(i) = {static_cast<std::uint32_t>(keys.at(i)), static_cast<std::uint32_t>(keys.at(i) >> 32U)};
+        }
+        std::vector<Point> corners(queries);
+        for (std::size_t i = 0; i < queries; i++)
+        {
+            const std::uint64_t k = keys.at(n + i);
+            corners.at(i) = {static_cast<std::uint32_t>(k) % (std::numeric_limits<std::uint32_t>::max() - Side),
+                             static_cast<std::uint32_t>(k >> 32U) % (std::numeric_limits<std::uint32_t>::max() - Side)};
+        }
+        const std::string                    params = "n=" + std::to_string(n);
+        cavl::RangeTree2D<Point, GetX, GetY> tree;
+        report("range_query", "rebuild", params, measure(n, [&] { tree.rebuild(points); }));
+        std::size_t hits = 0;
+        report("range_query", "linear_scan", params, measure(queries, [&] {
+                   for (const Point& c : corners)
+                   {
+                       for (const Point& p : points)
+                       {
+                           hits += static_cast<std::size_t>((p.x >= c.x) && (p.x <= (c.x + Side)) &&
+                                                            (p.y >= c.y) && (p.y <= (c.y + Side)));
+                       }
+                   }
+               }));
+        report("range_query", "range_tree", params, measure(queries, [&] {
+                   for (const Point& c : corners)
+                   {
+                       tree.query(c.x, c.x + Side, c.y, c.y + Side, [&hits](const Point& /*unused*/) { hits++; });
+                   }
+               }));
+        consume(hits);
+    }
+}
+
+/// Search and in-order scan of a heap-allocated tree versus the packed van Emde Boas layout, when freshly built and
+/// after a long run of churn replacing random values with new ones.
+void benchmarkCacheOblivious(const Options& opt)
+{
+    const std::size_t n       = opt.scaled(1'000'000);
+    const std::size_t churn   = 4U * n;
+    const std::size_t lookups = opt.scaled(1'000'000);
+    const auto        initial = makeKeys(n, 9);
+    const auto        fresh   = makeKeys(churn, 10);
+    const auto        victims = makeKeys(churn, 11);
+    const std::string params  = "n=" + std::to_string(n) + " churn=" + std::to_string(churn);
+    // Applies the same sequence of operations to either variant: each step removes a random value and adds a new one.
+    const auto run = [&](const std::string& variant, const auto& insert, const auto& remove, const auto& contains,
+                         const auto& scan) {
+        std::vector<std::uint64_t> live = initial;
+        for (const auto k : live)
+        {
+            insert(k);
+        }
+        const auto probe = [&](const std::string& phase) {
+            std::size_t hits = 0;
+            report("cache_oblivious", variant + "_search_" + phase, params, measure(lookups, [&] {
+                       for (std::size_t i = 0; i < lookups; i++)
+                       {
+                           hits += contains(live[(i * 7919U) % live.size()]) ? 1U : 0U;
+                       }
+                   }));
+            const double scan_ns = measure(live.size(), [&] { hits += scan(); });
+            report("cache_oblivious", variant + "_scan_" + phase, params, scan_ns);
+            consume(hits);
+        };
+        probe("fresh");
+        report("cache_oblivious", variant + "_churn", params, measure(churn, [&] {
+                   for (std::size_t i = 0; i < churn; i++)
+                   {
+                       const std::size_t victim = victims[i] % live.size();
+                       remove(live[victim]);
+                       live[victim] = fresh[i];
+                       insert(fresh[i]);
+                   }
+               }));
+        probe("churned");
+    };
+    {
+        ItemTree tree;
+        run(
+            "heap_tree",
+            [&](const std::uint64_t k) {
+                (void) tree.search([k](const Item& x) { return compareKeys(k, x.key); },
+                                   [k] { return new Item(k); });  // NOLINT(*-owning-memory)
+            },
+            [&](const std::uint64_t k) {
+                Item* const x = tree.search([k](const Item& v) { return compareKeys(k, v.key); });
+                tree.remove(x);
+                delete x;  // NOLINT(*-owning-memory)
+            },
+            [&](const std::uint64_t k) {
+                return tree.search([k](const Item& x) { return compareKeys(k, x.key); }) != nullptr;
+            },
+            [&] {
+                std::size_t sum = 0;
+                tree.traverseInOrder([&sum](const Item& x) { sum += static_cast<std::size_t>(x.key); });
+                return sum;
+            });
+        tree.reclaim([](Item& x) { delete &x; });  // NOLINT(*-owning-memory)
+    }
+    {
+        cavl::CacheOblivious<std::uint64_t> set;
+        run(
+            "veb_packed",
+            [&](const std::uint64_t k) { (void) set.insert(k); },
+            [&](const std::uint64_t k) { (void) set.remove(k); },
+            [&](const std::uint64_t k) { return set.contains(k); },
+            [&] {
+                std::size_t sum = 0;
+                set.traverse([&sum](const std::uint64_t x) { sum += static_cast<std::size_t>(x); });
+                return sum;
+            });
+    }
+}
+
+}  // namespace
+
+int main(const int argc, const char* const argv[])
+{
+    Options                  opt;
+    std::size_t              repetitions = 1;
+    std::string              json;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];  // NOLINT(*-pointer-arithmetic)
+        if (arg.rfind("--repetitions=", 0) == 0)
+        {
+            repetitions = std::max<std::size_t>(1U, std::strtoull(arg.substr(14).c_str(), nullptr, 10));
+        }
+        else if (arg.rfind("--json=", 0) == 0)
+        {
+            json = arg.substr(7);
+        }
+        else
+        {
+            positional.push_back(arg);
+        }
+    }
+    if (!positional.empty())
+    {
+        opt.filter = positional.at(0);
+    }
+    if (positional.size() > 1)
+    {
+        opt.scale = std::atof(positional.at(1).c_str());  // NOLINT
+    }
+    const std::vector<std::pair<std::string, std::function<void(const Options&)>>> scenarios{
+        {"replicated_reads", benchmarkReplicatedReads},
+        {"flat_combining", benchmarkFlatCombining},
+        {"delegation", benchmarkDelegation},
+        {"log_structured", benchmarkLogStructured},
+        {"auto_freeze", benchmarkAutoFreeze},
+        {"splay", benchmarkSplay},
+        {"path_cached", benchmarkPathCached},
+        {"forest", benchmarkForest},
+        {"sorted_search", benchmarkSortedSearch},
+        {"prefetch_scan", benchmarkPrefetchScan},
+        {"batched_scan", benchmarkBatchedScan},
+        {"purge", benchmarkPurge},
+        {"range_query", benchmarkRangeQuery},
+        {"cache_oblivious", benchmarkCacheOblivious},
+    };
+    // The repetitions are interleaved across the scenarios to spread slow drifts of the machine state evenly.
+    for (std::size_t rep = 0; rep < repetitions; rep++)
+    {
+        for (const auto& s : scenarios)
+        {
+            if (opt.enabled(s.first))
+            {
+                s.second(opt);
+            }
+        }
+    }
+    if ((!json.empty()) && (!writeJSON(json, opt, repetitions)))
+    {
+        (void) std::fprintf(stderr, "Could not write %s\n", json.c_str());
+        return 1;
+    }
+    return 0;
+}
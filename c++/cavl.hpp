@@ -27,10 +27,15 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <tuple>
 #include <type_traits>
 #include <utility>
 
+#if defined(CAVL_PROFILING) && CAVL_PROFILING
+#    include <atomic>
+#endif
+
 /// If CAVL is used in throughput-critical code, then it is recommended to disable assertion checks as they may
 /// be costly in terms of execution time.
 #ifndef CAVL_ASSERT
@@ -44,12 +49,69 @@
 #    endif
 #endif
 
+/// Optional USDT probes for tracing live processes using bpftrace, perf, or SystemTap; see tools/cavl.bt.
+/// The probes are enabled if CAVL_USDT is defined to a nonzero value and <sys/sdt.h> is available;
+/// otherwise, they are compiled out. The probes are shared with cavl.h, which carries an identical copy of the
+/// definitions below; whichever header is included first defines them for both. Except for the rotations, the probes
+/// identify the tree by the address of its origin node.
+#ifndef CAVL_PRIVATE_PROBE1
+#    if defined(CAVL_USDT) && CAVL_USDT && defined(__has_include)
+#        if __has_include(<sys/sdt.h>)
+#            ifndef _SYS_SDT_H
+#                define _SDT_HAS_SEMAPHORES 1  // NOLINT(*-reserved-identifier)
+#            endif
+#            include <sys/sdt.h>
+#            define CAVL_PRIVATE_USDT 1
+#        endif
+#    endif
+// NOLINTBEGIN(cppcoreguidelines-macro-usage) function-like macros
+#    if defined(CAVL_PRIVATE_USDT)
+#        define CAVL_PRIVATE_PROBE1(name, a) DTRACE_PROBE1(cavl, name, a)
+#        define CAVL_PRIVATE_PROBE2(name, a, b) DTRACE_PROBE2(cavl, name, a, b)
+#        define CAVL_PRIVATE_PROBE3(name, a, b, c) DTRACE_PROBE3(cavl, name, a, b, c)
+#    else
+#        define CAVL_PRIVATE_PROBE1(name, a) ((void) (a))
+#        define CAVL_PRIVATE_PROBE2(name, a, b) ((void) (a), (void) (b))
+#        define CAVL_PRIVATE_PROBE3(name, a, b, c) ((void) (a), (void) (b), (void) (c))
+#    endif
+// A probe whose arguments are costly to compute is guarded by CAVL_PRIVATE_PROBE_ENABLED(name), which reads the
+// semaphore that the tracer increments while attached. The semaphores are weak, so every translation unit may
+// define them. If <sys/sdt.h> has been included earlier without the semaphore support, the probes are always on.
+#    if defined(CAVL_PRIVATE_USDT) && defined(_SDT_HAS_SEMAPHORES)
+#        define CAVL_PRIVATE_SEMAPHORE(name) \
+            __attribute__((weak, section(".probes"), visibility("hidden"))) unsigned short cavl_##name##_semaphore = 0
+#        ifdef __cplusplus
+extern "C" {
+#        endif
+CAVL_PRIVATE_SEMAPHORE(search_entry);
+CAVL_PRIVATE_SEMAPHORE(search_return);
+CAVL_PRIVATE_SEMAPHORE(insert_return);
+CAVL_PRIVATE_SEMAPHORE(remove_entry);
+CAVL_PRIVATE_SEMAPHORE(remove_return);
+CAVL_PRIVATE_SEMAPHORE(rotate);
+#        ifdef __cplusplus
+}
+#        endif
+#        define CAVL_PRIVATE_PROBE_ENABLED(name) \
+            __builtin_expect(*(const volatile unsigned short*) &cavl_##name##_semaphore != 0, 0)
+#    elif defined(CAVL_PRIVATE_USDT)
+#        define CAVL_PRIVATE_PROBE_ENABLED(name) 1
+#    else
+#        define CAVL_PRIVATE_PROBE_ENABLED(name) 0
+#    endif
+// NOLINTEND(cppcoreguidelines-macro-usage)
+#endif
+
 // NOLINTBEGIN(cppcoreguidelines-pro-bounds-constant-array-index)
 
 namespace cavl
 {
 template <typename Derived>
 class Tree;
+template <typename Derived>
+class SplayTree;
+template <typename Derived>
+class Forest;
 
 /// The tree node type is to be composed with the user type through CRTP inheritance.
 /// For instance, the derived type might be a key-value pair struct defined in the user code.
@@ -76,6 +138,42 @@ public:
     using TreeType    = Tree<Derived>;
     using DerivedType = Derived;
 
+    /// An upper bound on the height of any AVL tree that fits in the address space.
+    static constexpr std::size_t MaxHeight = (sizeof(void*) * 8U * 3U) / 2U;
+
+    /// A root-to-node path recorded by searchPath() for use with insertAt(), removeAt(), and reposition().
+    /// These retrace the tree along the recorded path instead of climbing via the parent pointers, which removes
+    /// a chain of dependent loads from the update path. The path is consumed (emptied) by these operations.
+    /// Any other modification of the tree invalidates the path.
+    class Path final
+    {
+    public:
+        /// The number of nodes on the path.
+        auto size() const noexcept -> std::size_t { return size_; }
+
+        /// The matching node if the search was successful; otherwise, the parent of the node that would match,
+        /// or nullptr if the path is empty.
+        auto back() const noexcept -> Derived* { return (size_ > 0U) ? down(nodes_[size_ - 1U]) : nullptr; }
+
+        /// True if the path ends at a matching node.
+        auto isFound() const noexcept { return found_; }
+
+    private:
+        friend class Node;
+
+        void push(Node* const node) noexcept
+        {
+            CAVL_ASSERT(size_ < MaxHeight);
+            nodes_[size_++] = node;  // NOLINT(*-constant-array-index)
+        }
+
+        // The nodes are not initialized because only the first size_ elements are ever read.
+        std::array<Node*, MaxHeight> nodes_;  // NOLINT(*-member-init)
+        std::size_t                  size_  = 0;
+        bool                         found_ = false;
+        bool                         right_ = false;  ///< Unless found, the side of back() where the node would be.
+    };
+
     // Tree nodes cannot be copied for obvious reasons.
     Node(const Node&)                    = delete;
     auto operator=(const Node&) -> Node& = delete;
@@ -130,6 +228,34 @@ protected:
         return searchImpl<const Derived>(root, predicate);
     }
 
+    /// Look up a batch of keys sorted in ascending order (duplicates allowed) in a single pass over the tree.
+    /// The result for keys[i] is stored into out[i]; it is nullptr if there is no matching node.
+    /// The predicate is invoked with a constant reference to the key and to Derived; it returns POSITIVE if the key
+    /// is GREATER than the provided node, negative if smaller, zero on match. The predicate should be noexcept.
+    ///
+    /// Each search starts from the node where the previous one ended (the finger) rather than from the root,
+    /// climbing only as high as needed to reach the subtree that may contain the next key. Closely spaced keys
+    /// thus share most of the path, and the total complexity is O(k log(n/k)) rather than O(k log n).
+    /// The `root` shall be the actual root of the tree, not of a subtree.
+    template <typename Key, typename Pre>
+    static void searchSorted(Node* const       root,
+                             const Key* const  keys,
+                             const std::size_t count,
+                             const Pre&        predicate,
+                             Derived** const   out) noexcept
+    {
+        searchSortedImpl<Derived>(root, keys, count, predicate, out);
+    }
+    template <typename Key, typename Pre>
+    static void searchSorted(const Node* const     root,
+                             const Key* const      keys,
+                             const std::size_t     count,
+                             const Pre&            predicate,
+                             const Derived** const out) noexcept
+    {
+        searchSortedImpl<const Derived>(root, keys, count, predicate, out);
+    }
+
     /// This is like the regular search function except that if the node is missing, the factory will be invoked
     /// (without arguments) to construct a new one and insert it into the tree immediately.
     /// The root node (inside the origin) may be replaced in the process.
@@ -159,6 +285,47 @@ protected:
         unlink();
     }
 
+    /// This is like the regular search function except that the visited nodes are recorded into the path
+    /// for use with the following operations. The `root` shall be the actual root of the tree, not of a subtree.
+    template <typename Pre>
+    static auto searchPath(Node* const root, const Pre& predicate, Path& path) noexcept -> Derived*
+    {
+        path.size_  = 0;
+        path.found_ = false;
+        path.right_ = false;
+        Node* n     = root;
+        while (n != nullptr)
+        {
+            path.push(n);
+            const auto cmp = predicate(*down(n));
+            if (0 == cmp)
+            {
+                path.found_ = true;
+                return down(n);
+            }
+            path.right_ = cmp > 0;
+            n           = n->lr[path.right_];
+        }
+        return nullptr;
+    }
+
+    /// Inserts the new node where the unsuccessful searchPath() that recorded the path has ended.
+    /// The root node (inside the origin) may be replaced in the process.
+    static void insertAt(Node& origin, Path& path, Node* const node) noexcept;
+
+    /// Removes the node found by the successful searchPath() that recorded the path.
+    /// The root node (inside the origin) may be replaced in the process.
+    static void removeAt(Path& path) noexcept;
+
+    /// Moves the node found by the successful searchPath() that recorded the path to the position that matches its
+    /// new key after the key has been modified. The predicate compares the new key against the other nodes
+    /// like in search(); it is never invoked with the moved node itself. If the node is still ordered correctly with
+    /// respect to its in-order neighbors, the tree is not modified at all, which makes small key changes cheap.
+    /// Returns false if there is another node equivalent to the new key, in which case the moved node is left
+    /// removed from the tree (unlinked).
+    template <typename Pre>
+    static auto reposition(Node& origin, Path& path, const Pre& predicate) noexcept -> bool;
+
     /// These methods provide very fast retrieval of min/max values, either const or mutable.
     /// They return nullptr iff the tree is empty.
     static auto min(Node* const root) noexcept -> Derived* { return extremum(root, false); }
@@ -196,6 +363,53 @@ protected:
         traverseInOrderImpl<const Node>(root, visitor, reverse);
     }
 
+    /// Like traverseInOrder() but the visitor is invoked with batches of consecutive nodes rather than one node
+    /// at a time: visitor(Derived* const* nodes, std::size_t count), where count does not exceed BatchSize.
+    /// The batch is collected in a buffer on the stack, so the traversal loop does not call the visitor per node,
+    /// and the visitor can process the payload of the batch in a tight loop that the compiler is able to vectorize.
+    /// The early exit rules are the same as in traverseInOrder() but apply to the batch as a whole.
+    static constexpr std::size_t DefaultBatchSize = 64;
+    template <std::size_t BatchSize = DefaultBatchSize,
+              typename Vis,
+              typename R = invoke_result<Vis, Derived* const*, std::size_t>>
+    static auto traverseInOrderBatched(Derived* const root, const Vis& visitor, const bool reverse = false)  //
+        -> std::enable_if_t<!std::is_void<R>::value, R>
+    {
+        return traverseInOrderBatchedImpl<BatchSize, R, Node>(root, visitor, reverse);
+    }
+    template <std::size_t BatchSize = DefaultBatchSize, typename Vis>
+    static auto traverseInOrderBatched(Derived* const root, const Vis& visitor, const bool reverse = false)  //
+        -> std::enable_if_t<std::is_void<invoke_result<Vis, Derived* const*, std::size_t>>::value>
+    {
+        (void) traverseInOrderBatchedImpl<BatchSize, bool, Node>(
+            root,
+            [&visitor](Derived* const* const nodes, const std::size_t count) {
+                visitor(nodes, count);
+                return false;
+            },
+            reverse);
+    }
+    template <std::size_t BatchSize = DefaultBatchSize,
+              typename Vis,
+              typename R = invoke_result<Vis, const Derived* const*, std::size_t>>
+    static auto traverseInOrderBatched(const Derived* const root, const Vis& visitor, const bool reverse = false)  //
+        -> std::enable_if_t<!std::is_void<R>::value, R>
+    {
+        return traverseInOrderBatchedImpl<BatchSize, R, const Node>(root, visitor, reverse);
+    }
+    template <std::size_t BatchSize = DefaultBatchSize, typename Vis>
+    static auto traverseInOrderBatched(const Derived* const root, const Vis& visitor, const bool reverse = false)  //
+        -> std::enable_if_t<std::is_void<invoke_result<Vis, const Derived* const*, std::size_t>>::value>
+    {
+        (void) traverseInOrderBatchedImpl<BatchSize, bool, const Node>(
+            root,
+            [&visitor](const Derived* const* const nodes, const std::size_t count) {
+                visitor(nodes, count);
+                return false;
+            },
+            reverse);
+    }
+
     /// @breaf Post-order (or reverse-post-order) traversal of the tree.
     ///
     /// "Post" nature of the traversal guarantees that, once a node reference is passed to the visitor,
@@ -221,6 +435,46 @@ protected:
         traversePostOrderImpl<const Node>(root, visitor, reverse);
     }
 
+    /// Encodes the tree for storage without pointers, e.g., as a static table in ROM searchable by cavlStaticSearch()
+    /// from cavl.h. The nodes are arranged in the level order of a complete binary search tree (the Eytzinger layout):
+    /// the children of the node at index i are at 2i+1 (lesser) and 2i+2 (greater). The shape is implied by the node
+    /// count, so the encoding needs no space besides the keys regardless of the shape of the original tree.
+    /// The emitter is invoked as emit(std::size_t index, const Derived& node) for every node in order; it would
+    /// typically store the key of the node into an array of the size returned by Tree<>::size() at the index.
+    /// Returns the number of nodes. The complexity is linear and no memory is allocated.
+    template <typename Emit>
+    static auto encodeLevelOrder(const Derived* const root, const Emit& emit) -> std::size_t
+    {
+        std::size_t count = 0;
+        traverseInOrder(root, [&count](const Derived& /*unused*/) { count++; });
+        // Walk the implicit tree in order alongside the actual tree; the indexes are one-based to simplify arithmetic.
+        std::size_t index = 1;
+        while ((index * 2U) <= count)
+        {
+            index *= 2U;
+        }
+        traverseInOrder(root, [&emit, &index, count](const Derived& node) {
+            emit(index - 1U, node);
+            if (((index * 2U) + 1U) <= count)
+            {
+                index = (index * 2U) + 1U;  // The leftmost node of the right subtree is the successor.
+                while ((index * 2U) <= count)
+                {
+                    index *= 2U;
+                }
+            }
+            else
+            {
+                while ((index & 1U) != 0U)  // Ascend from the right subtrees, then once more from the left subtree.
+                {
+                    index >>= 1U;
+                }
+                index >>= 1U;
+            }
+        });
+        return count;
+    }
+
 private:
     void moveFrom(Node& other) noexcept
     {
@@ -250,6 +504,7 @@ private:
     {
         CAVL_ASSERT(isLinked());
         CAVL_ASSERT((lr[!r] != nullptr) && ((bf >= -1) && (bf <= +1)));
+        CAVL_PRIVATE_PROBE2(rotate, this, static_cast<int>(r));
         Node* const z             = lr[!r];
         up->lr[up->lr[1] == this] = z;
         z->up                     = up;
@@ -271,30 +526,68 @@ private:
     template <typename Result, typename NodeT, typename DerivedT, typename Vis>
     static auto traverseInOrderImpl(DerivedT* const root, const Vis& visitor, const bool reverse) -> Result;
 
+    template <std::size_t BatchSize, typename Result, typename NodeT, typename DerivedT, typename Vis>
+    static auto traverseInOrderBatchedImpl(DerivedT* const root, const Vis& visitor, const bool reverse) -> Result
+    {
+        static_assert(BatchSize > 0, "The batch shall not be empty");
+        std::array<DerivedT*, BatchSize> batch;  // NOLINT(*-member-init) only the filled part is ever read.
+        std::size_t                      count  = 0;
+        Result                           result = traverseInOrderImpl<Result, NodeT>(root, [&](DerivedT& x) {
+            batch[count++] = &x;
+            if (count < BatchSize)
+            {
+                return Result{};
+            }
+            count = 0;
+            return static_cast<Result>(visitor(batch.data(), BatchSize));
+        }, reverse);
+        if ((!result) && (count > 0U))
+        {
+            result = visitor(batch.data(), count);
+        }
+        return result;
+    }
+
     template <typename NodeT, typename DerivedT, typename Vis>
     static void traversePostOrderImpl(DerivedT* const root, const Vis& visitor, const bool reverse);
 
     static void removeImpl(const Node* const node) noexcept;
 
+    template <typename Vis>
+    static auto reclaimImpl(Node& origin, const Vis& visitor, const std::size_t budget) -> bool;
+
     template <typename DerivedT, typename NodeT, typename Pre>
     static auto searchImpl(NodeT* const root, const Pre& predicate) noexcept -> DerivedT*
     {
-        NodeT* n = root;
+        const Node* const tree = (root != nullptr) ? root->up : nullptr;  // The origin identifies the tree to probes.
+        CAVL_PRIVATE_PROBE1(search_entry, tree);
+        NodeT*      n     = root;
+        std::size_t depth = 0;  // The number of nodes visited.
         while (n != nullptr)
         {
             CAVL_ASSERT(nullptr != n->up);
 
+            depth++;
             DerivedT* const derived = down(n);
             const auto      cmp     = predicate(*derived);
             if (0 == cmp)
             {
+                CAVL_PRIVATE_PROBE3(search_return, tree, depth, derived);
                 return derived;
             }
             n = n->lr[cmp > 0];
         }
+        CAVL_PRIVATE_PROBE3(search_return, tree, depth, static_cast<DerivedT*>(nullptr));
         return nullptr;
     }
 
+    template <typename DerivedT, typename NodeT, typename Key, typename Pre>
+    static void searchSortedImpl(NodeT* const      root,
+                                 const Key* const  keys,
+                                 const std::size_t count,
+                                 const Pre&        predicate,
+                                 DerivedT** const  out) noexcept;
+
     template <typename DerivedT, typename NodeT>
     static auto getNextInOrderNodeImpl(NodeT* const node, const bool reverse) noexcept -> DerivedT*
     {
@@ -354,6 +647,8 @@ private:
     static auto down(const Node* x) noexcept -> const Derived* { return static_cast<const Derived*>(x); }
 
     friend class Tree<Derived>;
+    friend class SplayTree<Derived>;
+    friend class Forest<Derived>;
 
     Node*                up = nullptr;
     std::array<Node*, 2> lr{};
@@ -367,14 +662,17 @@ auto Node<Derived>::search(Node& origin, const Pre& predicate, const Fac& factor
     CAVL_ASSERT(!origin.isLinked());
     Node*& root = origin.lr[0];
 
-    Node* out = nullptr;
-    Node* up  = root;
-    Node* n   = root;
-    bool  r   = false;
+    CAVL_PRIVATE_PROBE1(search_entry, &origin);
+    Node*       out   = nullptr;
+    Node*       up    = root;
+    Node*       n     = root;
+    bool        r     = false;
+    std::size_t depth = 0;  // The number of nodes visited.
     while (n != nullptr)
     {
         CAVL_ASSERT(n->isLinked());
 
+        depth++;
         const auto cmp = predicate(*down(n));
         if (0 == cmp)
         {
@@ -388,6 +686,7 @@ auto Node<Derived>::search(Node& origin, const Pre& predicate, const Fac& factor
     }
     if (nullptr != out)
     {
+        CAVL_PRIVATE_PROBE3(search_return, &origin, depth, out);
         return std::make_tuple(down(out), true);
     }
 
@@ -395,6 +694,7 @@ auto Node<Derived>::search(Node& origin, const Pre& predicate, const Fac& factor
     CAVL_ASSERT(out != &origin);
     if (nullptr == out)
     {
+        CAVL_PRIVATE_PROBE3(search_return, &origin, depth, out);
         return std::make_tuple(nullptr, true);
     }
     out->unlink();
@@ -414,17 +714,80 @@ auto Node<Derived>::search(Node& origin, const Pre& predicate, const Fac& factor
     {
         root = rt;
     }
+    CAVL_PRIVATE_PROBE3(insert_return, &origin, depth, out);
     return std::make_tuple(down(out), false);
 }
 
+// The keys are sorted, hence the next key is never less than the lower bound of the subtree where the previous search
+// ended. It is therefore sufficient to climb until an ancestor that bounds the subtree from above exceeds the key.
+template <typename Derived>
+template <typename DerivedT, typename NodeT, typename Key, typename Pre>
+void Node<Derived>::searchSortedImpl(NodeT* const      root,
+                                     const Key* const  keys,
+                                     const std::size_t count,
+                                     const Pre&        predicate,
+                                     DerivedT** const  out) noexcept
+{
+    NodeT* finger = root;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const Key& key = keys[i];
+        NodeT*     n   = finger;
+        NodeT*     hit = nullptr;
+        while ((n != root) && (nullptr == hit))
+        {
+            NodeT* const p = n->up;
+            if (p->lr[0] == n)
+            {
+                const auto cmp = predicate(key, *down(p));
+                if (cmp < 0)
+                {
+                    break;
+                }
+                if (0 == cmp)
+                {
+                    hit = p;
+                }
+            }
+            n = p;
+        }
+        while ((n != nullptr) && (nullptr == hit))
+        {
+            CAVL_ASSERT(nullptr != n->up);
+            finger         = n;
+            const auto cmp = predicate(key, *down(n));
+            if (0 == cmp)
+            {
+                hit = n;
+            }
+            n = n->lr[cmp > 0];
+        }
+        finger = (nullptr != hit) ? hit : finger;
+        out[i] = down(hit);
+    }
+}
+
 template <typename Derived>
 void Node<Derived>::removeImpl(const Node* const node) noexcept
 {
     CAVL_ASSERT(node != nullptr);
     CAVL_ASSERT(node->isLinked());
+    // The origin identifies the tree to the probes; it is only looked up while they are traced because finding it
+    // costs a climb to the root.
+    const Node* tree = nullptr;
+    if (CAVL_PRIVATE_PROBE_ENABLED(remove_entry) || CAVL_PRIVATE_PROBE_ENABLED(remove_return))
+    {
+        tree = node;
+        while (tree->isLinked())
+        {
+            tree = tree->up;
+        }
+    }
+    CAVL_PRIVATE_PROBE2(remove_entry, tree, node);
 
-    Node* p = nullptr;  // The lowest parent node that suffered a shortening of its subtree.
-    bool  r = false;    // Which side of the above was shortened.
+    Node*       p     = nullptr;  // The lowest parent node that suffered a shortening of its subtree.
+    bool        r     = false;    // Which side of the above was shortened.
+    std::size_t depth = 0;        // The number of nodes visited while retracing.
     // The first step is to update the topology and remember the node where to start the retracing from later.
     // Balancing is not performed yet, so we may end up with an unbalanced tree.
     if ((node->lr[0] != nullptr) && (node->lr[1] != nullptr))
@@ -479,6 +842,7 @@ void Node<Derived>::removeImpl(const Node* const node) noexcept
     {
         for (;;)  // NOSONAR cpp:S5311
         {
+            depth++;
             Node* const c = p->adjustBalance(!r);
             CAVL_ASSERT(nullptr != c);
             p = c->getParentNode();
@@ -495,6 +859,142 @@ void Node<Derived>::removeImpl(const Node* const node) noexcept
             r = p->lr[1] == c;
         }
     }
+    CAVL_PRIVATE_PROBE2(remove_return, tree, depth);
+}
+
+template <typename Derived>
+void Node<Derived>::insertAt(Node& origin, Path& path, Node* const node) noexcept
+{
+    CAVL_ASSERT(!origin.isLinked());
+    CAVL_ASSERT((!path.found_) && (node != nullptr) && (node != &origin));
+    node->unlink();
+    if (0U == path.size_)
+    {
+        CAVL_ASSERT(nullptr == origin.lr[0]);
+        origin.lr[0] = node;
+        node->up     = &origin;
+        return;
+    }
+    Node* const parent = path.nodes_[path.size_ - 1U];  // NOLINT(*-constant-array-index)
+    CAVL_ASSERT(nullptr == parent->lr[path.right_]);
+    parent->lr[path.right_] = node;
+    node->up                = parent;
+    // Same as retraceOnGrowth() except that the parents are taken from the path. The rotations update the root.
+    Node* c = node;
+    for (std::size_t i = path.size_; i > 0U; i--)
+    {
+        Node* const p = path.nodes_[i - 1U];  // NOLINT(*-constant-array-index)
+        c             = p->adjustBalance(p->lr[1] == c);
+        if (0 == c->bf)
+        {
+            break;
+        }
+    }
+    path.size_ = 0;
+}
+
+template <typename Derived>
+void Node<Derived>::removeAt(Path& path) noexcept
+{
+    CAVL_ASSERT(path.found_ && (path.size_ > 0U));
+    const std::size_t index = path.size_ - 1U;
+    Node* const       node  = path.nodes_[index];  // NOLINT(*-constant-array-index)
+    CAVL_ASSERT(node->isLinked());
+    Node* p = nullptr;  // The lowest parent node that suffered a shortening of its subtree; it is at the back.
+    bool  r = false;    // Which side of the above was shortened.
+    // The topology is updated like in removeImpl(), except that the path is kept in sync with it.
+    if ((node->lr[0] != nullptr) && (node->lr[1] != nullptr))
+    {
+        Node* re = node->lr[1];  // The path is extended down to the replacement node.
+        path.push(re);
+        while (re->lr[0] != nullptr)
+        {
+            re = re->lr[0];
+            path.push(re);
+        }
+        re->bf        = node->bf;
+        re->lr[0]     = node->lr[0];
+        re->lr[0]->up = re;
+        if (re != node->lr[1])
+        {
+            p = path.nodes_[path.size_ - 2U];  // NOLINT(*-constant-array-index)
+            CAVL_ASSERT(p->lr[0] == re);
+            p->lr[0] = re->lr[1];
+            if (p->lr[0] != nullptr)
+            {
+                p->lr[0]->up = p;
+            }
+            re->lr[1]     = node->lr[1];
+            re->lr[1]->up = re;
+            r             = false;
+            path.size_--;
+        }
+        else
+        {
+            p          = re;
+            r          = true;
+            path.size_ = index + 1U;
+        }
+        path.nodes_[index]                = re;  // NOLINT(*-constant-array-index)
+        re->up                            = node->up;
+        re->up->lr[re->up->lr[1] == node] = re;
+    }
+    else
+    {
+        Node* const up = node->up;
+        const bool  rr = node->lr[1] != nullptr;
+        if (node->lr[rr] != nullptr)
+        {
+            node->lr[rr]->up = up;
+        }
+        r         = up->lr[1] == node;
+        up->lr[r] = node->lr[rr];
+        p         = up;
+        path.size_--;
+    }
+    node->unlink();
+    // Same as the retracing in removeImpl() except that the parents are taken from the path.
+    if (path.size_ > 0U)
+    {
+        CAVL_ASSERT(path.nodes_[path.size_ - 1U] == p);  // NOLINT(*-constant-array-index)
+        for (std::size_t i = path.size_ - 1U;; i--)
+        {
+            Node* const c = p->adjustBalance(!r);
+            if ((c->bf != 0) || (0U == i))
+            {
+                break;
+            }
+            p = path.nodes_[i - 1U];  // NOLINT(*-constant-array-index)
+            r = p->lr[1] == c;
+        }
+    }
+    path.size_  = 0;
+    path.found_ = false;
+}
+
+template <typename Derived>
+template <typename Pre>
+auto Node<Derived>::reposition(Node& origin, Path& path, const Pre& predicate) noexcept -> bool
+{
+    CAVL_ASSERT(path.found_ && (path.size_ > 0U));
+    Node* const       node = path.nodes_[path.size_ - 1U];  // NOLINT(*-constant-array-index)
+    const Node* const prev = node->getNextInOrderNode(true);
+    const Node* const next = node->getNextInOrderNode(false);
+    if (((prev == nullptr) || (predicate(*down(prev)) > 0)) && ((next == nullptr) || (predicate(*down(next)) < 0)))
+    {
+        path.size_  = 0;
+        path.found_ = false;
+        return true;
+    }
+    removeAt(path);
+    if (nullptr != searchPath(origin.lr[0], predicate, path))
+    {
+        path.size_  = 0;
+        path.found_ = false;
+        return false;
+    }
+    insertAt(origin, path, node);
+    return true;
 }
 
 template <typename Derived>
@@ -733,6 +1233,82 @@ void Node<Derived>::traversePostOrderImpl(DerivedT* const root, const Vis& visit
     }
 }
 
+// The walk is stackless: leaves are cut off one by one, so every node eventually becomes a leaf and the position
+// is implied by the remaining topology. Each call resumes by descending from the root, which costs O(log n).
+template <typename Derived>
+template <typename Vis>
+auto Node<Derived>::reclaimImpl(Node& origin, const Vis& visitor, const std::size_t budget) -> bool
+{
+    CAVL_ASSERT(!origin.isLinked());
+    std::size_t remaining = budget;
+    Node*       node      = origin.lr[0];
+    while ((nullptr != node) && (remaining > 0U))
+    {
+        if (nullptr != node->lr[0])
+        {
+            node = node->lr[0];
+        }
+        else if (nullptr != node->lr[1])
+        {
+            node = node->lr[1];
+        }
+        else
+        {
+            Node* const p           = node->up;  // The origin is not linked, hence we stop there.
+            p->lr[p->lr[1] == node] = nullptr;
+            node->unlink();
+            visitor(*down(node));  // The node is no longer referenced by the tree, so the visitor may destroy it.
+            remaining--;
+            node = p->isLinked() ? p : nullptr;
+        }
+    }
+    return nullptr == origin.lr[0];
+}
+
+/// The kinds of operations on Tree<> that are reported to the profiler.
+enum class Operation : std::uint8_t
+{
+    Search,
+    Insert,  ///< Search with a factory, regardless of whether a new node ends up being inserted.
+    Remove,
+    Traverse,
+};
+constexpr std::size_t OperationCount = 4;
+
+#if defined(CAVL_PROFILING) && CAVL_PROFILING
+/// If CAVL_PROFILING is enabled, every operation invoked via Tree<> is reported to the profiler installed globally
+/// using install(), if any. While no profiler is installed, the overhead is a single predictable branch per
+/// operation; if CAVL_PROFILING is not enabled, there is no overhead at all.
+/// The profiler is invoked from the threads that operate on the trees, so it shall be thread-safe.
+class Profiler
+{
+public:
+    /// Invoked before the operation. The returned token is passed to end() after the operation.
+    virtual auto begin(const void* const tree, const Operation op) noexcept -> std::uint64_t = 0;
+    virtual void end(const void* const tree, const Operation op, const std::uint64_t token) noexcept = 0;
+
+    /// Pass nullptr to uninstall. The profiler shall outlive the operations that may have observed it.
+    static void install(Profiler* const profiler) noexcept
+    {
+        getInstalled().store(profiler, std::memory_order_release);
+    }
+    static auto getInstalled() noexcept -> std::atomic<Profiler*>&
+    {
+        static std::atomic<Profiler*> instance{nullptr};
+        return instance;
+    }
+
+    Profiler(const Profiler&)                    = delete;
+    Profiler(Profiler&&)                         = delete;
+    auto operator=(const Profiler&) -> Profiler& = delete;
+    auto operator=(Profiler&&) -> Profiler&      = delete;
+
+protected:
+    Profiler()  = default;
+    ~Profiler() = default;
+};
+#endif
+
 /// This is a very simple convenience wrapper that is entirely optional to use.
 /// It simply keeps a single root pointer of the tree. The methods are mere wrappers over the static methods
 /// defined in the Node<> template class, such that the node pointer kept in the instance of this class is passed
@@ -748,6 +1324,7 @@ public:
     /// Helper alias of the compatible node type.
     using NodeType    = Node<Derived>;
     using DerivedType = Derived;
+    using Path        = typename NodeType::Path;
 
     Tree()  = default;
     ~Tree() = default;
@@ -771,22 +1348,64 @@ public:
         return *this;
     }
 
-    /// Wraps NodeType<>::search().
+    /// Wraps NodeType<>::search() and NodeType<>::searchSorted().
     template <typename Pre>
     auto search(const Pre& predicate) noexcept -> Derived*
     {
-        return NodeType::template search<Pre>(getRootNode(), predicate);
+        return profile(Operation::Search, [&] { return NodeType::template search<Pre>(getRootNode(), predicate); });
     }
     template <typename Pre>
     auto search(const Pre& predicate) const noexcept -> const Derived*
     {
-        return NodeType::template search<Pre>(getRootNode(), predicate);
+        return profile(Operation::Search, [&] { return NodeType::template search<Pre>(getRootNode(), predicate); });
+    }
+    template <typename Key, typename Pre>
+    void searchSorted(const Key* const  keys,
+                      const std::size_t count,
+                      const Pre&        predicate,
+                      Derived** const   out) noexcept
+    {
+        NodeType::template searchSorted<Key, Pre>(getRootNode(), keys, count, predicate, out);
+    }
+    template <typename Key, typename Pre>
+    void searchSorted(const Key* const      keys,
+                      const std::size_t     count,
+                      const Pre&            predicate,
+                      const Derived** const out) const noexcept
+    {
+        NodeType::template searchSorted<Key, Pre>(getRootNode(), keys, count, predicate, out);
     }
     template <typename Pre, typename Fac>
     auto search(const Pre& predicate, const Fac& factory) -> std::tuple<Derived*, bool>
     {
         CAVL_ASSERT(!traversal_in_progress_);  // Cannot modify the tree while it is being traversed.
-        return NodeType::template search<Pre, Fac>(origin_node_, predicate, factory);
+        return profile(Operation::Insert,
+                       [&] { return NodeType::template search<Pre, Fac>(origin_node_, predicate, factory); });
+    }
+
+    /// Wraps NodeType<>::searchPath(), insertAt(), removeAt(), and reposition(). See NodeType<>::Path.
+    template <typename Pre>
+    auto searchPath(const Pre& predicate, Path& path) noexcept -> Derived*
+    {
+        return profile(Operation::Search,
+                       [&] { return NodeType::template searchPath<Pre>(getRootNode(), predicate, path); });
+    }
+    void insertAt(Path& path, NodeType* const node) noexcept
+    {
+        CAVL_ASSERT(!traversal_in_progress_);  // Cannot modify the tree while it is being traversed.
+        profile(Operation::Insert, [&] { NodeType::insertAt(origin_node_, path, node); });
+    }
+    void removeAt(Path& path) noexcept
+    {
+        CAVL_ASSERT(!traversal_in_progress_);  // Cannot modify the tree while it is being traversed.
+        profile(Operation::Remove, [&] { NodeType::removeAt(path); });
+    }
+    template <typename Pre>
+    auto reposition(Path& path, const Pre& predicate) noexcept -> bool
+    {
+        CAVL_ASSERT(!traversal_in_progress_);  // Cannot modify the tree while it is being traversed.
+        return profile(Operation::Insert,
+                       [&] { return NodeType::template reposition<Pre>(origin_node_, path, predicate); });
     }
 
     /// The function has no effect if the node pointer is nullptr, or node is not in the tree (aka unlinked).
@@ -808,7 +1427,7 @@ public:
         CAVL_ASSERT(!traversal_in_progress_);  // Cannot modify the tree while it is being traversed.
         if ((node != nullptr) && node->isLinked())
         {
-            node->remove();
+            profile(Operation::Remove, [node] { node->remove(); });
         }
     }
 
@@ -822,28 +1441,141 @@ public:
     template <typename Vis>
     auto traverseInOrder(const Vis& visitor, const bool reverse = false)
     {
-        const TraversalIndicatorUpdater upd(*this);
-        return NodeType::template traverseInOrder<Vis>(*this, visitor, reverse);
+        return profile(Operation::Traverse, [&] {
+            const TraversalIndicatorUpdater upd(*this);
+            return NodeType::template traverseInOrder<Vis>(*this, visitor, reverse);
+        });
     }
     template <typename Vis>
     auto traverseInOrder(const Vis& visitor, const bool reverse = false) const
     {
-        const TraversalIndicatorUpdater upd(*this);
-        return NodeType::template traverseInOrder<Vis>(*this, visitor, reverse);
+        return profile(Operation::Traverse, [&] {
+            const TraversalIndicatorUpdater upd(*this);
+            return NodeType::template traverseInOrder<Vis>(*this, visitor, reverse);
+        });
+    }
+
+    /// Wraps NodeType<>::traverseInOrderBatched().
+    template <std::size_t BatchSize = NodeType::DefaultBatchSize, typename Vis>
+    auto traverseInOrderBatched(const Vis& visitor, const bool reverse = false)
+    {
+        return profile(Operation::Traverse, [&] {
+            const TraversalIndicatorUpdater upd(*this);
+            return NodeType::template traverseInOrderBatched<BatchSize, Vis>(*this, visitor, reverse);
+        });
+    }
+    template <std::size_t BatchSize = NodeType::DefaultBatchSize, typename Vis>
+    auto traverseInOrderBatched(const Vis& visitor, const bool reverse = false) const
+    {
+        return profile(Operation::Traverse, [&] {
+            const TraversalIndicatorUpdater upd(*this);
+            return NodeType::template traverseInOrderBatched<BatchSize, Vis>(*this, visitor, reverse);
+        });
     }
 
     /// Wraps NodeType<>::traversePostOrder().
     template <typename Vis>
     void traversePostOrder(const Vis& visitor, const bool reverse = false)
     {
-        const TraversalIndicatorUpdater upd(*this);
-        NodeType::template traversePostOrder<Vis>(*this, visitor, reverse);
+        profile(Operation::Traverse, [&] {
+            const TraversalIndicatorUpdater upd(*this);
+            NodeType::template traversePostOrder<Vis>(*this, visitor, reverse);
+        });
     }
     template <typename Vis>
     void traversePostOrder(const Vis& visitor, const bool reverse = false) const
     {
-        const TraversalIndicatorUpdater upd(*this);
-        NodeType::template traversePostOrder<Vis>(*this, visitor, reverse);
+        profile(Operation::Traverse, [&] {
+            const TraversalIndicatorUpdater upd(*this);
+            NodeType::template traversePostOrder<Vis>(*this, visitor, reverse);
+        });
+    }
+
+    /// Wraps NodeType<>::encodeLevelOrder().
+    template <typename Emit>
+    auto encodeLevelOrder(const Emit& emit) const -> std::size_t
+    {
+        return profile(Operation::Traverse, [&] {
+            const TraversalIndicatorUpdater upd(*this);
+            return NodeType::template encodeLevelOrder<Emit>(*this, emit);
+        });
+    }
+
+    /// Incrementally dismantles the tree, unlinking up to `budget` nodes per call in post-order (children first).
+    /// Each node is unlinked before the visitor is invoked with a reference to it, so the visitor may destroy it.
+    /// Returns true once the tree is empty. The walk is stackless; each call costs O(log n + budget).
+    ///
+    /// Large trees can be torn down off the critical path by moving the tree into a new Tree instance first,
+    /// which detaches all nodes from the original tree in constant time, and then handing the new instance over
+    /// to a background task or a low-priority thread that calls this method until it returns true:
+    ///
+    ///     Tree<T> orphan{std::move(tree)};  // `tree` is now empty and can be reused immediately.
+    ///     while (!orphan.reclaim([](T& x) { delete &x; }, 1024)) { /* yield */ }
+    ///
+    /// In hosted environments, cavl::Reclaimer from cavl_concurrent.hpp does exactly that on a background thread.
+    ///
+    /// Balancing is not maintained while the reclamation is in progress, so the tree shall not be modified
+    /// in any other way until it is empty.
+    template <typename Vis>
+    auto reclaim(const Vis& visitor, const std::size_t budget = std::numeric_limits<std::size_t>::max()) -> bool
+    {
+        CAVL_ASSERT(!traversal_in_progress_);  // Cannot modify the tree while it is being traversed.
+        return NodeType::template reclaimImpl<Vis>(origin_node_, visitor, budget);
+    }
+
+    /// A cursor over the nodes in order (or in reverse order) that, unlike the traversal methods, allows modifying
+    /// the tree while it is in use: the current node can be erased via the cursor, and other nodes can be inserted
+    /// or removed via the tree as usual; the nodes inserted ahead of the cursor will be visited. This is possible
+    /// because the successor is located from the current topology on every step, which costs O(1) amortized.
+    /// The only forbidden modification is removing the current node other than via erase().
+    ///
+    ///     for (auto cur = tree.getCursor(); cur;)
+    ///     {
+    ///         if (isExpired(*cur.get())) { delete cur.erase(); } else { cur.next(); }
+    ///     }
+    class Cursor final
+    {
+    public:
+        /// The current node, or nullptr if the cursor has run past the last node.
+        auto get() const noexcept -> Derived* { return node_; }
+        explicit operator bool() const noexcept { return node_ != nullptr; }
+
+        void next() noexcept
+        {
+            CAVL_ASSERT(node_ != nullptr);
+            node_ = node_->getNextInOrderNode(reverse_);
+        }
+
+        /// Removes the current node from the tree and moves the cursor to its successor.
+        /// Returns the removed node, so that the caller can destroy it.
+        auto erase() noexcept -> Derived*
+        {
+            CAVL_ASSERT(node_ != nullptr);
+            Derived* const out = node_;
+            node_              = out->getNextInOrderNode(reverse_);  // The removal may move it but it stays valid.
+            tree_->remove(out);
+            return out;
+        }
+
+    private:
+        friend class Tree;
+        Cursor(Tree& tree, Derived* const node, const bool reverse) noexcept :
+            tree_(&tree), node_(node), reverse_(reverse)
+        {}
+
+        Tree*    tree_;
+        Derived* node_;
+        bool     reverse_;
+    };
+
+    /// Returns a cursor positioned at the first (or the last if reverse) node, or at the specified node of this tree.
+    auto getCursor(const bool reverse = false) noexcept -> Cursor
+    {
+        return Cursor(*this, reverse ? max() : min(), reverse);
+    }
+    auto getCursor(Derived* const node, const bool reverse = false) noexcept -> Cursor
+    {
+        return Cursor(*this, node, reverse);
     }
 
     /// Normally these are not needed except if advanced introspection is desired.
@@ -910,6 +1642,44 @@ private:
         const Tree& that;
     };
 
+    /// Invokes the operation, reporting it to the profiler if there is one (see Profiler).
+    template <typename F>
+    auto profile(const Operation op, const F& fn) const -> decltype(fn())
+    {
+#if defined(CAVL_PROFILING) && CAVL_PROFILING
+        if (Profiler* const profiler = Profiler::getInstalled().load(std::memory_order_acquire))
+        {
+            const ProfilerScope scope(*profiler, this, op);
+            return fn();
+        }
+#else
+        (void) op;
+#endif
+        return fn();
+    }
+
+#if defined(CAVL_PROFILING) && CAVL_PROFILING
+    class ProfilerScope final
+    {
+    public:
+        ProfilerScope(Profiler& profiler, const Tree* const tree, const Operation op) noexcept :
+            profiler_(profiler), tree_(tree), op_(op), token_(profiler.begin(tree, op))
+        {}
+        ~ProfilerScope() noexcept { profiler_.end(tree_, op_, token_); }
+
+        ProfilerScope(const ProfilerScope&)                    = delete;
+        ProfilerScope(ProfilerScope&&)                         = delete;
+        auto operator=(const ProfilerScope&) -> ProfilerScope& = delete;
+        auto operator=(ProfilerScope&&) -> ProfilerScope&      = delete;
+
+    private:
+        Profiler&           profiler_;
+        const Tree* const   tree_;
+        const Operation     op_;
+        const std::uint64_t token_;
+    };
+#endif
+
     // root node pointer is stored in the origin_node_ left child.
     auto getRootNode() noexcept -> Derived* { return origin_node_.getChildNode(false); }
     auto getRootNode() const noexcept -> const Derived* { return origin_node_.getChildNode(false); }
@@ -926,6 +1696,353 @@ private:
     mutable volatile bool traversal_in_progress_ = false;  // NOSONAR cpp:S3687
 };
 
+/// An alternative to Tree<> that uses the same node type but restructures itself on every access instead of
+/// maintaining the AVL balance: the accessed node is splayed to the root through a sequence of rotations.
+/// Recently accessed nodes therefore stay close to the root, which benefits workloads with strong locality
+/// of reference, such as a small hot working set or sequential access, where the average search path can be much
+/// shorter than in an AVL tree. The complexity of all operations is O(log n) amortized, but a single operation may
+/// take linear time, and lookups modify the tree, so unlike Tree<> it cannot be searched concurrently even if
+/// there are no writers. The balance factors of the nodes are not used and remain zero.
+///
+/// The node type is the same as for Tree<>, so the choice between the policies is made per tree.
+/// The nodes of a splay tree shall not be removed via Node<>::remove(), which assumes the AVL balance;
+/// use SplayTree<>::remove() instead. The static read-only methods of Node<>, such as the traversals,
+/// can be applied to the root of a splay tree as usual.
+template <typename Derived>
+class SplayTree final  // NOSONAR cpp:S3624 (see Tree<>)
+{
+public:
+    /// Helper alias of the compatible node type.
+    using NodeType    = Node<Derived>;
+    using DerivedType = Derived;
+
+    SplayTree()  = default;
+    ~SplayTree() = default;
+
+    /// Trees cannot be copied.
+    SplayTree(const SplayTree&)                    = delete;
+    auto operator=(const SplayTree&) -> SplayTree& = delete;
+
+    /// Trees can be easily moved in constant time. This does not actually affect the tree itself, only this object.
+    SplayTree(SplayTree&& other) noexcept : origin_node_{std::move(other.origin_node_)} {}
+    auto operator=(SplayTree&& other) noexcept -> SplayTree&
+    {
+        origin_node_ = std::move(other.origin_node_);
+        return *this;
+    }
+
+    /// The semantics of the arguments and of the result is the same as for Tree<>::search().
+    /// The found node is splayed to the root; if there is none, the last node on the search path is splayed instead,
+    /// which is necessary to retain the amortized complexity bound.
+    template <typename Pre>
+    auto search(const Pre& predicate) noexcept -> Derived*
+    {
+        NodeType* last = nullptr;
+        bool      r    = false;
+        NodeType* out  = descend(predicate, last, r);
+        splay(((out != nullptr) ? out : last), &origin_node_);
+        return NodeType::down(out);
+    }
+
+    /// The semantics of the arguments and of the result is the same as for Tree<>::search() with a factory.
+    /// The found or inserted node is splayed to the root.
+    template <typename Pre, typename Fac>
+    auto search(const Pre& predicate, const Fac& factory) -> std::tuple<Derived*, bool>
+    {
+        NodeType* last = nullptr;
+        bool      r    = false;
+        NodeType* out  = descend(predicate, last, r);
+        if (out != nullptr)
+        {
+            splay(out, &origin_node_);
+            return std::make_tuple(NodeType::down(out), true);
+        }
+        out = factory();
+        CAVL_ASSERT(out != &origin_node_);
+        if (nullptr == out)
+        {
+            splay(last, &origin_node_);
+            return std::make_tuple(nullptr, true);
+        }
+        out->unlink();
+        if (last != nullptr)
+        {
+            CAVL_ASSERT(last->lr[r] == nullptr);
+            last->lr[r] = out;
+            out->up     = last;
+            splay(out, &origin_node_);
+        }
+        else
+        {
+            origin_node_.lr[0] = out;
+            out->up            = &origin_node_;
+        }
+        return std::make_tuple(NodeType::down(out), false);
+    }
+
+    /// The function has no effect if the node pointer is nullptr, or node is not in the tree (aka unlinked).
+    /// The node is splayed to the root and replaced with its in-order predecessor, which is splayed to the top
+    /// of the left subtree first, so that it has no right child.
+    void remove(NodeType* const node) noexcept  // NOSONAR cpp:S6936
+    {
+        if ((node == nullptr) || (!node->isLinked()))
+        {
+            return;
+        }
+        splay(node, &origin_node_);
+        CAVL_ASSERT(origin_node_.lr[0] == node);
+        NodeType* const left  = node->lr[0];
+        NodeType* const right = node->lr[1];
+        NodeType*       top   = right;
+        if (left != nullptr)
+        {
+            top = NodeType::extremum(left, true);
+            splay(top, node);
+            CAVL_ASSERT((node->lr[0] == top) && (top->lr[1] == nullptr));
+            top->lr[1] = right;
+            if (right != nullptr)
+            {
+                right->up = top;
+            }
+        }
+        origin_node_.lr[0] = top;
+        if (top != nullptr)
+        {
+            top->up = &origin_node_;
+        }
+        node->unlink();
+    }
+
+    /// These do not restructure the tree.
+    auto min() noexcept -> Derived* { return NodeType::min(getRootNode()); }
+    auto max() noexcept -> Derived* { return NodeType::max(getRootNode()); }
+    auto min() const noexcept -> const Derived* { return NodeType::min(getRootNode()); }
+    auto max() const noexcept -> const Derived* { return NodeType::max(getRootNode()); }
+
+    /// Wraps NodeType<>::traverseInOrder().
+    template <typename Vis>
+    auto traverseInOrder(const Vis& visitor, const bool reverse = false)
+    {
+        return NodeType::template traverseInOrder<Vis>(getRootNode(), visitor, reverse);
+    }
+    template <typename Vis>
+    auto traverseInOrder(const Vis& visitor, const bool reverse = false) const
+    {
+        return NodeType::template traverseInOrder<Vis>(getRootNode(), visitor, reverse);
+    }
+
+    /// The semantics is the same as for Tree<>::reclaim().
+    template <typename Vis>
+    auto reclaim(const Vis& visitor, const std::size_t budget = std::numeric_limits<std::size_t>::max()) -> bool
+    {
+        return NodeType::template reclaimImpl<Vis>(origin_node_, visitor, budget);
+    }
+
+    /// Normally these are not needed except if advanced introspection is desired.
+    ///
+    /// No linting and Sonar cpp:S1709 b/c implicit conversion by design.
+    // NOLINTNEXTLINE(google-explicit-constructor,hicpp-explicit-conversions)
+    operator Derived*() noexcept  // NOSONAR cpp:S1709
+    {
+        return getRootNode();
+    }
+    // NOLINTNEXTLINE(google-explicit-constructor,hicpp-explicit-conversions)
+    operator const Derived*() const noexcept  // NOSONAR cpp:S1709
+    {
+        return getRootNode();
+    }
+
+    /// Beware that this convenience method has linear complexity. Use responsibly.
+    auto size() const noexcept
+    {
+        auto i = 0UL;
+        traverseInOrder([&i](auto& /*unused*/) { i++; });
+        return i;
+    }
+
+    /// Unlike size(), this one is constant-complexity.
+    auto empty() const noexcept { return getRootNode() == nullptr; }
+
+private:
+    static_assert(!std::is_polymorphic<NodeType>::value,
+                  "Internal check: The node type must not be a polymorphic type");
+
+    /// Returns the matching node or nullptr; in the latter case, the search ended at the specified side of last.
+    template <typename Pre>
+    auto descend(const Pre& predicate, NodeType*& last, bool& r) noexcept -> NodeType*
+    {
+        NodeType* n = origin_node_.lr[0];
+        while (n != nullptr)
+        {
+            const auto cmp = predicate(*NodeType::down(n));
+            if (0 == cmp)
+            {
+                return n;
+            }
+            last = n;
+            r    = cmp > 0;
+            n    = n->lr[r];
+        }
+        return nullptr;
+    }
+
+    /// Lifts the node by rotations until its parent is the specified ancestor (the origin to make it the root).
+    /// The nodes are lifted two levels at a time (zig-zig or zig-zag), except for the last step if the distance is odd.
+    static void splay(NodeType* const x, const NodeType* const stop) noexcept
+    {
+        if (x == nullptr)
+        {
+            return;
+        }
+        while (x->up != stop)
+        {
+            NodeType* const p  = x->up;
+            const bool      dx = p->lr[1] == x;
+            if (p->up == stop)
+            {
+                p->rotate(!dx);  // zig
+            }
+            else
+            {
+                NodeType* const g  = p->up;
+                const bool      dp = g->lr[1] == p;
+                if (dx == dp)
+                {
+                    g->rotate(!dp);  // zig-zig: the parent is lifted first
+                    p->rotate(!dx);
+                }
+                else
+                {
+                    p->rotate(!dx);  // zig-zag
+                    g->rotate(!dp);
+                }
+            }
+        }
+    }
+
+    auto getRootNode() noexcept -> Derived* { return origin_node_.getChildNode(false); }
+    auto getRootNode() const noexcept -> const Derived* { return origin_node_.getChildNode(false); }
+
+    // The root node pointer is stored in the left child of this fake node, like in Tree<>.
+    Node<Derived> origin_node_{};
+};
+
+/// A set of independent trees that share a single origin node, so that each tree is represented by its root node
+/// pointer alone (one word) instead of a Tree<> instance. This is useful when there are many small trees, where
+/// the origin node embedded in every Tree<> would take more memory than the trees themselves.
+/// The root pointers are stored by the user anywhere they like and passed to the methods of this class,
+/// which update them as necessary. All roots refer to the origin node of the forest, hence it cannot be moved.
+///
+/// The nodes of the trees in a forest shall not be removed via Node<>::remove(), because it would not update
+/// the root pointer; use Forest<>::remove() instead. The static read-only methods of Node<>, such as the traversals,
+/// can be applied to the roots as usual. A root node shall not be moved, because the move would not update the root
+/// pointer either. The methods operate on one tree at a time via the shared origin,
+/// so even the operations on different trees shall not be invoked concurrently.
+template <typename Derived>
+class Forest final  // NOSONAR cpp:S3624 (see Tree<>)
+{
+public:
+    /// Helper alias of the compatible node type.
+    using NodeType    = Node<Derived>;
+    using DerivedType = Derived;
+
+    Forest()  = default;
+    ~Forest() = default;
+
+    Forest(const Forest&)                    = delete;
+    Forest(Forest&&)                         = delete;
+    auto operator=(const Forest&) -> Forest& = delete;
+    auto operator=(Forest&&) -> Forest&      = delete;
+
+    /// Wraps NodeType<>::search(); the search does not modify the tree, so the origin is not involved.
+    template <typename Pre>
+    static auto search(Derived* const root, const Pre& predicate) noexcept -> Derived*
+    {
+        return NodeType::template search<Pre>(root, predicate);
+    }
+    template <typename Pre>
+    static auto search(const Derived* const root, const Pre& predicate) noexcept -> const Derived*
+    {
+        return NodeType::template search<Pre>(root, predicate);
+    }
+
+    /// Wraps NodeType<>::search() with a factory; the root pointer may be updated in the process.
+    template <typename Pre, typename Fac>
+    auto search(Derived*& root, const Pre& predicate, const Fac& factory) -> std::tuple<Derived*, bool>
+    {
+        attach(root);
+        const auto out = NodeType::template search<Pre, Fac>(origin_node_, predicate, factory);
+        root           = detach();
+        return out;
+    }
+
+    /// The function has no effect if the node pointer is nullptr, or node is not in the tree (aka unlinked).
+    /// The node shall belong to the tree with the specified root; the root pointer may be updated in the process.
+    void remove(Derived*& root, NodeType* const node) noexcept  // NOSONAR cpp:S6936
+    {
+        if ((node != nullptr) && node->isLinked())
+        {
+            attach(root);
+            node->remove();
+            root = detach();
+        }
+    }
+
+    /// Wraps NodeType<>::traverseInOrder().
+    template <typename Vis>
+    static auto traverseInOrder(Derived* const root, const Vis& visitor, const bool reverse = false)
+    {
+        return NodeType::template traverseInOrder<Vis>(root, visitor, reverse);
+    }
+    template <typename Vis>
+    static auto traverseInOrder(const Derived* const root, const Vis& visitor, const bool reverse = false)
+    {
+        return NodeType::template traverseInOrder<Vis>(root, visitor, reverse);
+    }
+
+    /// The semantics is the same as for Tree<>::reclaim(); the root pointer is updated to reflect the progress.
+    template <typename Vis>
+    auto reclaim(Derived*&         root,
+                 const Vis&        visitor,
+                 const std::size_t budget = std::numeric_limits<std::size_t>::max()) -> bool
+    {
+        attach(root);
+        const bool done = NodeType::template reclaimImpl<Vis>(origin_node_, visitor, budget);
+        root            = detach();
+        return done;
+    }
+
+    /// The height of the tree is computed in logarithmic time by following the heavier side at every level.
+    static auto getHeight(const Derived* const root) noexcept -> std::size_t
+    {
+        std::size_t     height = 0;
+        const NodeType* n      = root;
+        while (n != nullptr)
+        {
+            height++;
+            n = n->lr[n->bf > 0];
+        }
+        return height;
+    }
+
+private:
+    void attach(NodeType* const root) noexcept
+    {
+        CAVL_ASSERT((root == nullptr) || (root->up == &origin_node_));  // The root shall belong to this forest.
+        origin_node_.lr[0] = root;
+    }
+    auto detach() noexcept -> Derived*
+    {
+        NodeType* const root = origin_node_.lr[0];
+        origin_node_.lr[0]   = nullptr;
+        return NodeType::down(root);
+    }
+
+    // The root nodes of all trees refer to this node as their parent, but only one of them is referred back from it
+    // at any given time: the one that is being modified.
+    Node<Derived> origin_node_{};
+};
+
 }  // namespace cavl
 
 // NOLINTEND(cppcoreguidelines-pro-bounds-constant-array-index)
@@ -0,0 +1,1821 @@
+/// Source: https://github.com/pavel-kirienko/cavl
+///
+/// This is an optional companion to cavl.hpp providing concurrent containers built on top of cavl::Tree.
+/// Unlike the core header, it is intended for hosted environments only: it requires C++17, the standard
+/// thread support library, and dynamic memory. Embedded applications should use cavl.hpp alone.
+///
+/// Copyright (c) 2021 Pavel Kirienko <pavel@uavcan.org>
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+/// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+/// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+/// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+/// the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+/// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+/// OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+/// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include "cavl.hpp"
+#include "cavl_containers.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if __cplusplus < 201703L
+#    error "cavl_concurrent.hpp requires C++17 or newer"
+#endif
+
+#if defined(CAVL_PROFILING) && CAVL_PROFILING
+#    if defined(__x86_64__) || defined(__i386__)
+#        include <x86intrin.h>
+#    endif
+#endif
+
+// NOLINTBEGIN(cppcoreguidelines-pro-bounds-constant-array-index)
+
+namespace cavl
+{
+/// Assumed size of the cache line used to keep independently updated state apart to avoid false sharing.
+constexpr std::size_t CacheLineSize = 64;
+
+namespace detail
+{
+/// The set of values behind the containers that apply all operations on one thread at a time, such as FlatCombined
+/// and Delegated. Only the size may be read concurrently with the operations.
+template <typename T, typename Compare>
+class SerialSet final
+{
+public:
+    enum class Op : std::uint8_t
+    {
+        Insert,    ///< The result is false if an equivalent value is already present; the set is not modified then.
+        Remove,    ///< The result is false if there is no value equivalent to the key.
+        Contains,  ///< The result is true if there is a value equivalent to the key.
+    };
+
+    explicit SerialSet(const Compare& compare) : compare_(compare) {}
+
+    ~SerialSet()
+    {
+        tree_.reclaim([](Entry& x) { delete &x; });  // NOLINT(*-owning-memory)
+    }
+
+    SerialSet(const SerialSet&)                    = delete;
+    SerialSet(SerialSet&&)                         = delete;
+    auto operator=(const SerialSet&) -> SerialSet& = delete;
+    auto operator=(SerialSet&&) -> SerialSet&      = delete;
+
+    /// The value is moved from only if it is inserted.
+    auto apply(const Op op, T& value) -> bool
+    {
+        const auto predicate = [&](const Entry& x) { return compare_(value, x.value); };
+        switch (op)
+        {
+        case Op::Insert:
+        {
+            const auto res = tree_.search(predicate, [&] { return new Entry(std::move(value)); });  // NOLINT
+            if (!std::get<1>(res))
+            {
+                size_.store(size_.load(std::memory_order_relaxed) + 1U, std::memory_order_relaxed);
+            }
+            return !std::get<1>(res);
+        }
+        case Op::Remove:
+        {
+            Entry* const entry = tree_.search(predicate);
+            if (nullptr != entry)
+            {
+                tree_.remove(entry);
+                delete entry;  // NOLINT(*-owning-memory)
+                size_.store(size_.load(std::memory_order_relaxed) - 1U, std::memory_order_relaxed);
+            }
+            return nullptr != entry;
+        }
+        case Op::Contains:
+        {
+            return nullptr != tree_.search(predicate);
+        }
+        }
+        return false;
+    }
+
+    auto size() const noexcept -> std::size_t { return size_.load(std::memory_order_relaxed); }
+    auto less() const noexcept -> const Compare& { return compare_.less(); }
+
+private:
+    class Entry final : public Node<Entry>
+    {
+    public:
+        explicit Entry(T&& val) : value(std::move(val)) {}
+        T value;
+    };
+
+    const ThreeWay<Compare>  compare_;
+    Tree<Entry>              tree_;
+    std::atomic<std::size_t> size_{0};
+};
+
+/// Lets threads sleep until a condition is made true by another thread, which then notifies them; the notifier
+/// takes the lock only if somebody is asleep. The waiter announces itself and then checks the condition, while
+/// the notifier makes the condition true and then checks the announcement; both sides shall use sequentially
+/// consistent accesses, which ensures that either side observes the other, so a notification cannot be missed.
+class ParkingLot final
+{
+public:
+    ParkingLot()  = default;
+    ~ParkingLot() = default;
+
+    ParkingLot(const ParkingLot&)                    = delete;
+    ParkingLot(ParkingLot&&)                         = delete;
+    auto operator=(const ParkingLot&) -> ParkingLot& = delete;
+    auto operator=(ParkingLot&&) -> ParkingLot&      = delete;
+
+    template <typename Pre>
+    void wait(const Pre& ready)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        (void) parked_.fetch_add(1U, std::memory_order_seq_cst);
+        cv_.wait(lock, ready);
+        (void) parked_.fetch_sub(1U, std::memory_order_relaxed);
+    }
+
+    void notify()
+    {
+        if (parked_.load(std::memory_order_seq_cst) > 0U)
+        {
+            {
+                const std::lock_guard<std::mutex> lock(mutex_);  // Keeps the notification after the wait.
+            }
+            cv_.notify_all();
+        }
+    }
+
+private:
+    std::mutex               mutex_;
+    std::condition_variable  cv_;
+    std::atomic<std::size_t> parked_{0};
+};
+}  // namespace detail
+
+/// An ordered set of values optimized for read-mostly workloads on many-core machines.
+///
+/// The set keeps one cavl tree replica per reader group (typically one per core), all referencing a shared store
+/// of the values; a replica only contains small intrusive hook nodes. Readers always search their local replica
+/// under a lock that is private to that replica, so the upper levels of the tree are never shared between cores
+/// and the readers of different replicas do not contend.
+///
+/// Writers are serialized. Each mutation is applied to an authoritative primary tree and then published into
+/// a bounded operation log. The replicas are brought up to date lazily from the log by their own readers before
+/// each lookup; if some replica falls behind by the whole log capacity, the writer replays the log into it.
+/// Removed values are destroyed once every replica has applied the removal.
+///
+/// The replica index passed to the read methods is chosen by the caller, e.g., the current CPU number
+/// modulo the replica count; any index is correct, the choice only affects the performance.
+template <typename T, typename Compare = std::less<T>>
+class Replicated final
+{
+public:
+    explicit Replicated(const std::size_t replica_count,
+                        const std::size_t log_capacity = 1024,
+                        const Compare&    compare      = Compare{}) :
+        replica_count_(replica_count),
+        log_capacity_(log_capacity),
+        compare_(compare),
+        replicas_(std::make_unique<Replica[]>(replica_count)),
+        log_(std::make_unique<Op[]>(log_capacity))
+    {
+        CAVL_ASSERT((replica_count > 0U) && (log_capacity > 0U));
+    }
+
+    ~Replicated()
+    {
+        primary_.reclaim([](Entry& x) { delete &x; });  // NOLINT(*-owning-memory)
+        reclaimRetired(std::numeric_limits<std::uint64_t>::max());
+    }
+
+    Replicated(const Replicated&)                    = delete;
+    Replicated(Replicated&&)                         = delete;
+    auto operator=(const Replicated&) -> Replicated& = delete;
+    auto operator=(Replicated&&) -> Replicated&      = delete;
+
+    /// Returns false if an equivalent value is already present, in which case the set is not modified.
+    auto insert(T value) -> bool
+    {
+        const std::lock_guard<std::mutex> lock(write_mutex_);
+        Entry* created = nullptr;
+        (void) primary_.search([&](const Entry& x) { return compare_(value, x.value); },
+                               [&] {
+                                   created = new Entry(std::move(value), replica_count_);  // NOLINT(*-owning-memory)
+                                   return created;
+                               });
+        if (nullptr != created)
+        {
+            publish(Op{created, true});
+            size_++;
+        }
+        return nullptr != created;
+    }
+
+    /// The predicate is invoked with a const reference to the value and follows the convention of Node<>::search().
+    /// Returns false if there is no matching value.
+    template <typename Pre>
+    auto remove(const Pre& predicate) -> bool
+    {
+        const std::lock_guard<std::mutex> lock(write_mutex_);
+        Entry* const entry = primary_.search([&](const Entry& x) { return predicate(x.value); });
+        if (nullptr != entry)
+        {
+            primary_.remove(entry);
+            entry->retired_at = tail_.load(std::memory_order_relaxed);
+            if (retired_tail_ != nullptr)
+            {
+                retired_tail_->next_retired = entry;
+            }
+            else
+            {
+                retired_head_ = entry;
+            }
+            retired_tail_ = entry;
+            publish(Op{entry, false});
+            size_--;
+        }
+        return nullptr != entry;
+    }
+
+    /// Looks up a value in the specified replica; if found, the visitor is invoked with a const reference to it
+    /// while the replica is locked and true is returned. The predicate follows the convention of Node<>::search().
+    template <typename Pre, typename Vis>
+    auto read(const std::size_t replica, const Pre& predicate, const Vis& visitor) -> bool
+    {
+        CAVL_ASSERT(replica < replica_count_);
+        Replica&                          rep = replicas_[replica];
+        const std::lock_guard<std::mutex> lock(rep.mutex);
+        catchUp(rep, replica);
+        if (const Hook* const hook = rep.tree.search([&](const Hook& x) { return predicate(x.entry->value); }))
+        {
+            visitor(hook->entry->value);
+            return true;
+        }
+        return false;
+    }
+    template <typename Pre>
+    auto contains(const std::size_t replica, const Pre& predicate) -> bool
+    {
+        return read(replica, predicate, [](const T& /*unused*/) {});
+    }
+
+    /// Brings all replicas up to date and destroys the values whose removal has been applied everywhere.
+    /// This is never required for correctness but it allows releasing the memory held by removed values eagerly.
+    void synchronize()
+    {
+        const std::lock_guard<std::mutex> lock(write_mutex_);
+        for (std::size_t i = 0; i < replica_count_; i++)
+        {
+            const std::lock_guard<std::mutex> rep_lock(replicas_[i].mutex);
+            catchUp(replicas_[i], i);
+        }
+        reclaimRetired(getMinApplied());
+    }
+
+    auto size() const -> std::size_t
+    {
+        const std::lock_guard<std::mutex> lock(write_mutex_);
+        return size_;
+    }
+    auto getReplicaCount() const noexcept { return replica_count_; }
+
+private:
+    class Entry;
+
+    /// A replica-local node that refers to the shared value.
+    class Hook final : public Node<Hook>
+    {
+    public:
+        const Entry* entry = nullptr;
+    };
+
+    class Entry final : public Node<Entry>
+    {
+    public:
+        Entry(T&& val, const std::size_t replica_count) : value(std::move(val)), hooks(new Hook[replica_count])
+        {
+            for (std::size_t i = 0; i < replica_count; i++)
+            {
+                hooks[i].entry = this;
+            }
+        }
+
+        T                       value;
+        std::unique_ptr<Hook[]> hooks;  // One per replica. NOLINT(*-avoid-c-arrays)
+        std::uint64_t           retired_at   = 0;
+        Entry*                  next_retired = nullptr;
+    };
+
+    struct Op final
+    {
+        Entry* entry  = nullptr;
+        bool   insert = false;
+    };
+
+    struct alignas(CacheLineSize) Replica final
+    {
+        std::mutex                 mutex;
+        std::atomic<std::uint64_t> applied{0};  // Number of log entries applied to this replica.
+        Tree<Hook>                 tree;
+    };
+
+    /// The replica shall be locked by the caller.
+    void catchUp(Replica& rep, const std::size_t index)
+    {
+        const std::uint64_t tail = tail_.load(std::memory_order_acquire);
+        std::uint64_t       seq  = rep.applied.load(std::memory_order_relaxed);
+        if (seq == tail)
+        {
+            return;  // This is the hot path.
+        }
+        for (; seq < tail; seq++)
+        {
+            const Op& op   = log_[seq % log_capacity_];
+            Hook&     hook = op.entry->hooks[index];
+            if (op.insert)
+            {
+                (void) rep.tree.search([&](const Hook& x) { return compare_(op.entry->value, x.entry->value); },
+                                       [&] { return &hook; });
+            }
+            else
+            {
+                rep.tree.remove(&hook);
+            }
+        }
+        rep.applied.store(tail, std::memory_order_release);
+    }
+
+    /// The writer lock shall be held by the caller.
+    void publish(const Op& op)
+    {
+        const std::uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if ((tail - getMinApplied()) >= log_capacity_)  // Some replicas are lagging; bring them up to date.
+        {
+            for (std::size_t i = 0; i < replica_count_; i++)
+            {
+                if ((tail - replicas_[i].applied.load(std::memory_order_acquire)) >= log_capacity_)
+                {
+                    const std::lock_guard<std::mutex> lock(replicas_[i].mutex);
+                    catchUp(replicas_[i], i);
+                }
+            }
+        }
+        log_[tail % log_capacity_] = op;
+        tail_.store(tail + 1U, std::memory_order_release);
+        reclaimRetired(getMinApplied());
+    }
+
+    auto getMinApplied() const -> std::uint64_t
+    {
+        std::uint64_t out = std::numeric_limits<std::uint64_t>::max();
+        for (std::size_t i = 0; i < replica_count_; i++)
+        {
+            out = std::min(out, replicas_[i].applied.load(std::memory_order_acquire));
+        }
+        return out;
+    }
+
+    /// Destroys the removed entries whose removal has been applied to all replicas (sequence number below the limit).
+    void reclaimRetired(const std::uint64_t limit)
+    {
+        while ((retired_head_ != nullptr) && (retired_head_->retired_at < limit))
+        {
+            Entry* const next = retired_head_->next_retired;
+            delete retired_head_;  // NOLINT(*-owning-memory)
+            retired_head_ = next;
+        }
+        if (nullptr == retired_head_)
+        {
+            retired_tail_ = nullptr;
+        }
+    }
+
+    const std::size_t               replica_count_;
+    const std::size_t               log_capacity_;
+    const detail::ThreeWay<Compare> compare_;
+
+    std::unique_ptr<Replica[]> replicas_;  // NOLINT(*-avoid-c-arrays)
+    std::unique_ptr<Op[]>      log_;       // NOLINT(*-avoid-c-arrays)
+
+    alignas(CacheLineSize) std::atomic<std::uint64_t> tail_{0};  // Number of log entries published so far.
+
+    alignas(CacheLineSize) mutable std::mutex write_mutex_;
+    Tree<Entry> primary_;
+    std::size_t size_         = 0;
+    Entry*      retired_head_ = nullptr;
+    Entry*      retired_tail_ = nullptr;
+};
+
+/// An ordered set of values where concurrent operations are executed using flat combining.
+///
+/// Each thread publishes its operation into its own slot and then either waits for the result or, if nobody else
+/// is doing so, acquires the combiner role and executes all pending operations of all threads as a single batch.
+/// This avoids handing the lock and the tree over between threads on every operation: the tree stays in the cache
+/// of the combiner, and the waiting threads only spin on their own slots for a short while before they park until
+/// the combiner is done. The batch is sorted by key before being applied, so that consecutive operations traverse
+/// mostly the same path from the root.
+///
+/// The slot index passed to every operation shall be unique per thread and less than the slot count.
+template <typename T, typename Compare = std::less<T>>
+class FlatCombined final
+{
+public:
+    explicit FlatCombined(const std::size_t slot_count, const Compare& compare = Compare{}) :
+        slot_count_(slot_count), slots_(std::make_unique<Slot[]>(slot_count)), set_(compare)
+    {
+        CAVL_ASSERT(slot_count > 0U);
+        batch_.reserve(slot_count);
+    }
+
+    ~FlatCombined() = default;
+
+    FlatCombined(const FlatCombined&)                    = delete;
+    FlatCombined(FlatCombined&&)                         = delete;
+    auto operator=(const FlatCombined&) -> FlatCombined& = delete;
+    auto operator=(FlatCombined&&) -> FlatCombined&      = delete;
+
+    /// Returns false if an equivalent value is already present, in which case the set is not modified.
+    auto insert(const std::size_t slot, T value) -> bool { return execute(slot, Op::Insert, std::move(value)); }
+
+    /// Returns false if there is no value equivalent to the key.
+    auto remove(const std::size_t slot, T key) -> bool { return execute(slot, Op::Remove, std::move(key)); }
+
+    auto contains(const std::size_t slot, T key) -> bool { return execute(slot, Op::Contains, std::move(key)); }
+
+    /// The result may be outdated by the time it is returned if there are concurrent mutations.
+    auto size() const noexcept -> std::size_t { return set_.size(); }
+    auto getSlotCount() const noexcept { return slot_count_; }
+
+private:
+    using Op = typename detail::SerialSet<T, Compare>::Op;
+
+    /// The number of polls of the own slot after which a waiting thread parks until the combiner is done.
+    static constexpr std::size_t SpinLimit = 100;
+
+    struct alignas(CacheLineSize) Slot final
+    {
+        std::atomic<bool>  pending{false};  // Set by the owner, cleared by the combiner when the result is ready.
+        Op                 op = Op::Contains;
+        std::optional<T>   value;
+        bool               result = false;
+        std::exception_ptr error;  ///< Set instead of the result if the operation has thrown.
+    };
+
+    /// Releases the combiner role even if the combining is interrupted, and wakes up the parked threads.
+    class CombinerGuard final
+    {
+    public:
+        explicit CombinerGuard(FlatCombined& owner) noexcept : owner_(owner) {}
+        ~CombinerGuard() noexcept
+        {
+            owner_.combiner_.store(false, std::memory_order_seq_cst);
+            owner_.parking_.notify();
+        }
+
+        CombinerGuard(const CombinerGuard&)                    = delete;
+        CombinerGuard(CombinerGuard&&)                         = delete;
+        auto operator=(const CombinerGuard&) -> CombinerGuard& = delete;
+        auto operator=(CombinerGuard&&) -> CombinerGuard&      = delete;
+
+    private:
+        FlatCombined& owner_;
+    };
+
+    auto execute(const std::size_t slot, const Op op, T&& value) -> bool
+    {
+        CAVL_ASSERT(slot < slot_count_);
+        Slot& sl = slots_[slot];
+        CAVL_ASSERT(!sl.pending.load(std::memory_order_relaxed));
+        sl.op = op;
+        sl.value.emplace(std::move(value));
+        sl.pending.store(true, std::memory_order_release);
+        std::size_t spins = 0;
+        while (sl.pending.load(std::memory_order_acquire))
+        {
+            if ((!combiner_.load(std::memory_order_relaxed)) && (!combiner_.exchange(true, std::memory_order_acquire)))
+            {
+                const CombinerGuard guard(*this);
+                combine();
+            }
+            else if (++spins < SpinLimit)
+            {
+                std::this_thread::yield();
+            }
+            else
+            {
+                // The combiner releases its role only after the batch is completed, so the slot is either completed
+                // by then or the thread can become the combiner itself.
+                parking_.wait([&] {
+                    return !sl.pending.load(std::memory_order_seq_cst) || !combiner_.load(std::memory_order_seq_cst);
+                });
+                spins = 0;
+            }
+        }
+        if (sl.error)
+        {
+            std::rethrow_exception(std::exchange(sl.error, nullptr));
+        }
+        return sl.result;
+    }
+
+    /// Invoked by the thread that holds the combiner role.
+    void combine()
+    {
+        batch_.clear();
+        for (std::size_t i = 0; i < slot_count_; i++)
+        {
+            if (slots_[i].pending.load(std::memory_order_acquire))
+            {
+                batch_.push_back(&slots_[i]);
+            }
+        }
+        // The batch does not reallocate because its capacity equals the slot count. The exceptions thrown by the
+        // operations are delivered to the threads that requested them, so the combiner never leaves a slot pending.
+        try
+        {
+            std::sort(batch_.begin(), batch_.end(), [this](const Slot* const a, const Slot* const b) {
+                return set_.less()(*a->value, *b->value);
+            });
+        }
+        catch (...)
+        {
+            for (Slot* const sl : batch_)
+            {
+                complete(*sl, false, std::current_exception());
+            }
+            return;
+        }
+        for (Slot* const sl : batch_)
+        {
+            bool               result = false;
+            std::exception_ptr error;
+            try
+            {
+                result = set_.apply(sl->op, *sl->value);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+            complete(*sl, result, std::move(error));
+        }
+    }
+
+    static void complete(Slot& sl, const bool result, std::exception_ptr error) noexcept
+    {
+        sl.result = result;
+        sl.error  = std::move(error);
+        sl.value.reset();
+        sl.pending.store(false, std::memory_order_release);
+    }
+
+    const std::size_t       slot_count_;
+    std::unique_ptr<Slot[]> slots_;  // NOLINT(*-avoid-c-arrays)
+
+    alignas(CacheLineSize) std::atomic<bool> combiner_{false};
+    detail::ParkingLot parking_;
+
+    // The following state is modified only by the combiner.
+    alignas(CacheLineSize) detail::SerialSet<T, Compare> set_;
+    std::vector<Slot*> batch_;
+};
+
+/// An ordered set where all operations are delegated to a dedicated owner thread, so that the tree stays in the cache
+/// of one core instead of bouncing between the cores of the threads that use it.
+///
+/// Every client has its own bounded single-producer single-consumer request ring, so the clients never contend with
+/// each other and a request is published with a single store. The owner thread drains all rings in batches, sorts
+/// each batch by key so that consecutive operations traverse mostly the same path from the root, applies the
+/// operations, and completes them by invoking the callbacks supplied with the requests. The sorting is stable,
+/// so the operations submitted by one client on equivalent keys take effect in the order of submission.
+/// When there are no requests, the owner spins for a short while and then parks until the next submission;
+/// likewise, the blocking operations spin for a short while and then park until their requests are completed.
+///
+/// The client index passed to every operation shall be unique per thread and less than the client count.
+/// The callbacks are invoked on the owner thread and shall not access the set.
+template <typename T, typename Compare = std::less<T>>
+class Delegated final
+{
+public:
+    using Op       = typename detail::SerialSet<T, Compare>::Op;
+    using Callback = std::function<void(bool)>;
+
+    /// The ring capacity shall be a power of two.
+    explicit Delegated(const std::size_t client_count,
+                       const std::size_t ring_capacity = 64,
+                       const Compare&    compare       = Compare{}) :
+        client_count_(client_count),
+        ring_capacity_(ring_capacity),
+        rings_(std::make_unique<Ring[]>(client_count)),
+        set_(compare)
+    {
+        CAVL_ASSERT(client_count > 0U);
+        CAVL_ASSERT((ring_capacity > 0U) && ((ring_capacity & (ring_capacity - 1U)) == 0U));
+        for (std::size_t i = 0; i < client_count; i++)
+        {
+            rings_[i].requests = std::make_unique<Request[]>(ring_capacity);
+        }
+        tails_.resize(client_count);
+        batch_.reserve(client_count * ring_capacity);
+        owner_ = std::thread([this] { run(); });
+    }
+
+    /// The pending requests are completed before the owner thread is stopped.
+    ~Delegated()
+    {
+        stop_.store(true, std::memory_order_seq_cst);
+        wake();
+        owner_.join();
+    }
+
+    Delegated(const Delegated&)                    = delete;
+    Delegated(Delegated&&)                         = delete;
+    auto operator=(const Delegated&) -> Delegated& = delete;
+    auto operator=(Delegated&&) -> Delegated&      = delete;
+
+    /// Enqueues the operation and returns immediately; the callback is invoked with the result on the owner thread.
+    /// If the ring of the client is full, waits for the owner to make room first.
+    void submit(const std::size_t client, const Op op, T value, Callback done)
+    {
+        CAVL_ASSERT(client < client_count_);
+        Ring&             ring = rings_[client];
+        const std::size_t tail = ring.tail.load(std::memory_order_relaxed);
+        while ((tail - ring.head.load(std::memory_order_acquire)) >= ring_capacity_)
+        {
+            std::this_thread::yield();
+        }
+        Request& req = ring.requests[tail & (ring_capacity_ - 1U)];
+        req.op       = op;
+        req.value.emplace(std::move(value));
+        req.done = std::move(done);
+        // Sequential consistency pairs the publication with the parking flag; see park().
+        ring.tail.store(tail + 1U, std::memory_order_seq_cst);
+        if (parked_.load(std::memory_order_seq_cst))
+        {
+            wake();
+        }
+    }
+
+    /// Like the callback-based overload, but the result is delivered via a future.
+    auto submit(const std::size_t client, const Op op, T value) -> std::future<bool>
+    {
+        auto promise = std::make_shared<std::promise<bool>>();
+        auto future  = promise->get_future();
+        submit(client, op, std::move(value), [promise](const bool result) { promise->set_value(result); });
+        return future;
+    }
+
+    /// Blocking operations that wait for the result without allocating memory.
+    auto insert(const std::size_t client, T value) -> bool { return execute(client, Op::Insert, std::move(value)); }
+    auto remove(const std::size_t client, T key) -> bool { return execute(client, Op::Remove, std::move(key)); }
+    auto contains(const std::size_t client, T key) -> bool { return execute(client, Op::Contains, std::move(key)); }
+
+    /// The result may be outdated by the time it is returned if there are pending requests.
+    auto size() const noexcept -> std::size_t { return set_.size(); }
+    auto getClientCount() const noexcept { return client_count_; }
+
+private:
+    /// The number of empty polls of all rings after which the owner parks, and the number of polls of the result
+    /// after which a blocked client parks.
+    static constexpr std::size_t SpinLimit = 1000;
+
+    struct Request final
+    {
+        Op               op = Op::Contains;
+        std::optional<T> value;
+        Callback         done;
+    };
+
+    /// The indexes grow monotonically and are wrapped when accessing the requests.
+    struct Ring final
+    {
+        alignas(CacheLineSize) std::atomic<std::size_t> head{0};  ///< Advanced by the owner.
+        alignas(CacheLineSize) std::atomic<std::size_t> tail{0};  ///< Advanced by the client.
+        std::unique_ptr<Request[]> requests;                      // NOLINT(*-avoid-c-arrays)
+    };
+
+    /// The callback does not touch the state of the client after publishing the result, so the client may return
+    /// as soon as it observes the result.
+    auto execute(const std::size_t client, const Op op, T&& value) -> bool
+    {
+        std::atomic<int> state{-1};
+        submit(client, op, std::move(value), [this, &state](const bool result) {
+            state.store(result ? 1 : 0, std::memory_order_seq_cst);
+            done_parking_.notify();
+        });
+        for (std::size_t spins = 0; spins < SpinLimit; spins++)
+        {
+            const int result = state.load(std::memory_order_acquire);
+            if (result >= 0)
+            {
+                return result > 0;
+            }
+            std::this_thread::yield();
+        }
+        done_parking_.wait([&state] { return state.load(std::memory_order_seq_cst) >= 0; });
+        return state.load(std::memory_order_acquire) > 0;
+    }
+
+    void wake()
+    {
+        {
+            const std::lock_guard<std::mutex> lock(mutex_);  // Prevents the notification from slipping before the wait.
+        }
+        parked_cv_.notify_one();
+    }
+
+    void run()
+    {
+        std::size_t idle = 0;
+        while (true)
+        {
+            if (drain() > 0U)
+            {
+                idle = 0;
+            }
+            else if (stop_.load(std::memory_order_seq_cst))
+            {
+                break;  // The clients are gone and all submitted requests have been completed.
+            }
+            else if (++idle < SpinLimit)
+            {
+                std::this_thread::yield();
+            }
+            else
+            {
+                park();
+                idle = 0;
+            }
+        }
+    }
+
+    /// The owner announces that it is about to sleep and then checks the rings once more, while the clients publish
+    /// the request and then check the announcement; sequential consistency ensures that either side observes
+    /// the other, so a submission cannot be missed. The timeout is a safety net only.
+    void park()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        parked_.store(true, std::memory_order_seq_cst);
+        (void) parked_cv_.wait_for(lock, std::chrono::milliseconds(10), [this] {
+            return hasPending() || stop_.load(std::memory_order_seq_cst);
+        });
+        parked_.store(false, std::memory_order_relaxed);
+    }
+
+    auto hasPending() const -> bool
+    {
+        for (std::size_t i = 0; i < client_count_; i++)
+        {
+            const Ring& ring = rings_[i];
+            if (ring.tail.load(std::memory_order_seq_cst) != ring.head.load(std::memory_order_relaxed))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Completes all requests published so far and returns their number.
+    auto drain() -> std::size_t
+    {
+        batch_.clear();
+        for (std::size_t i = 0; i < client_count_; i++)
+        {
+            const Ring&       ring = rings_[i];
+            const std::size_t tail = ring.tail.load(std::memory_order_acquire);
+            tails_[i]              = tail;
+            for (std::size_t k = ring.head.load(std::memory_order_relaxed); k != tail; k++)
+            {
+                batch_.push_back(&ring.requests[k & (ring_capacity_ - 1U)]);
+            }
+        }
+        std::stable_sort(batch_.begin(), batch_.end(), [this](const Request* const a, const Request* const b) {
+            return set_.less()(*a->value, *b->value);
+        });
+        for (Request* const req : batch_)
+        {
+            const bool result = set_.apply(req->op, *req->value);
+            req->value.reset();
+            const Callback done = std::move(req->done);
+            req->done           = nullptr;
+            if (done)
+            {
+                done(result);
+            }
+        }
+        // The slots are handed back to the clients only after the requests are completed.
+        for (std::size_t i = 0; i < client_count_; i++)
+        {
+            rings_[i].head.store(tails_[i], std::memory_order_release);
+        }
+        return batch_.size();
+    }
+
+    const std::size_t       client_count_;
+    const std::size_t       ring_capacity_;
+    std::unique_ptr<Ring[]> rings_;  // NOLINT(*-avoid-c-arrays)
+
+    alignas(CacheLineSize) std::atomic<bool> parked_{false};
+    std::atomic<bool>       stop_{false};
+    std::mutex              mutex_;
+    std::condition_variable parked_cv_;
+    detail::ParkingLot      done_parking_;  ///< The blocked clients wait here for their requests to be completed.
+
+    // The following state is accessed only by the owner thread.
+    alignas(CacheLineSize) detail::SerialSet<T, Compare> set_;
+    std::vector<Request*>    batch_;
+    std::vector<std::size_t> tails_;
+    std::thread              owner_;
+};
+
+/// An ordered set of values optimized for write-heavy workloads, structured as a small log-structured merge tree.
+///
+/// Mutations are blind writes into a small mutable cavl tree (the write buffer), where a removal is recorded
+/// as a tombstone that shadows the value in the lower level. The lower level is a large immutable sorted array
+/// that is both compact and cache-friendly. When the write buffer reaches the configured capacity, it is sealed
+/// in constant time and a new empty buffer takes its place, while a background thread merges the sealed buffer
+/// into a new version of the sorted array in linear time. If the next buffer fills up before the merge is finished,
+/// the writer waits for it. Lookups consult the write buffer, the sealed buffer (if any), and the sorted array,
+/// in this order, and the first match wins.
+///
+/// All operations are thread-safe; they are serialized by a single lock that is never held during the merge.
+template <typename T, typename Compare = std::less<T>>
+class LogStructured final
+{
+public:
+    explicit LogStructured(const std::size_t buffer_capacity, const Compare& compare = Compare{}) :
+        buffer_capacity_(buffer_capacity), compare_(compare), frozen_(std::make_shared<const std::vector<T>>())
+    {
+        CAVL_ASSERT(buffer_capacity > 0U);
+    }
+
+    ~LogStructured()
+    {
+        if (worker_.joinable())
+        {
+            worker_.join();
+        }
+        active_.reclaim([](Entry& x) { delete &x; });  // NOLINT(*-owning-memory)
+        sealed_.reclaim([](Entry& x) { delete &x; });  // NOLINT(*-owning-memory)
+    }
+
+    LogStructured(const LogStructured&)                    = delete;
+    LogStructured(LogStructured&&)                         = delete;
+    auto operator=(const LogStructured&) -> LogStructured& = delete;
+    auto operator=(LogStructured&&) -> LogStructured&      = delete;
+
+    /// An equivalent value, if present, is replaced.
+    void insert(T value) { write(std::move(value), false); }
+
+    /// Removing a missing value has no effect other than a tombstone in the write buffer.
+    void remove(T key) { write(std::move(key), true); }
+
+    /// If the value is found, the visitor is invoked with a const reference to it and true is returned.
+    template <typename Vis>
+    auto find(const T& key, const Vis& visitor) const -> bool
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        for (const Tree<Entry>* const buffer : {&active_, &sealed_})
+        {
+            if (const Entry* const entry = buffer->search([&](const Entry& x) { return compare_(key, x.value); }))
+            {
+                if (!entry->tombstone)
+                {
+                    visitor(entry->value);
+                }
+                return !entry->tombstone;
+            }
+        }
+        const std::vector<T>& frozen = *frozen_;
+        const auto            it     = std::lower_bound(frozen.begin(), frozen.end(), key, compare_.less());
+        if ((it != frozen.end()) && (!compare_.less()(key, *it)))
+        {
+            visitor(*it);
+            return true;
+        }
+        return false;
+    }
+    auto contains(const T& key) const -> bool
+    {
+        return find(key, [](const T& /*unused*/) {});
+    }
+
+    /// Visits all values in order. The visitor shall not access the set.
+    template <typename Vis>
+    void traverse(const Vis& visitor) const
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        mergeLevels(active_, sealed_, *frozen_, visitor);
+    }
+
+    /// Merges the write buffer into the sorted array and waits for the merge to complete.
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!active_.empty())
+        {
+            seal(lock);
+        }
+        idle_.wait(lock, [this] { return !merging_; });
+    }
+
+    /// The number of values in the sorted array, which does not account for the write buffers.
+    auto getFrozenSize() const -> std::size_t
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        return frozen_->size();
+    }
+
+private:
+    class Entry final : public Node<Entry>
+    {
+    public:
+        Entry(T&& val, const bool tomb) : value(std::move(val)), tombstone(tomb) {}
+        using Node<Entry>::getNextInOrderNode;
+
+        T    value;
+        bool tombstone;
+    };
+
+    using Frozen = std::shared_ptr<const std::vector<T>>;
+
+    void write(T&& value, const bool tombstone)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        Entry* created = nullptr;
+        Entry* entry   = std::get<0>(active_.search([&](const Entry& x) { return compare_(value, x.value); },
+                                                  [&] {
+                                                      created = new Entry(std::move(value), tombstone);  // NOLINT
+                                                      return created;
+                                                  }));
+        if (entry != created)  // The value is already in the write buffer, possibly as a tombstone; update it.
+        {
+            entry->value     = std::move(value);
+            entry->tombstone = tombstone;
+        }
+        else if (++active_size_ >= buffer_capacity_)
+        {
+            seal(lock);
+        }
+        else
+        {
+            // The buffer has room for more entries.
+        }
+    }
+
+    /// Hands the write buffer over to a new background merge, waiting for the previous one first if necessary.
+    void seal(std::unique_lock<std::mutex>& lock)
+    {
+        idle_.wait(lock, [this] { return !merging_; });
+        if (worker_.joinable())
+        {
+            worker_.join();  // The previous worker is done by now and does not need the lock anymore.
+        }
+        sealed_      = std::move(active_);
+        active_size_ = 0;
+        merging_     = true;
+        worker_      = std::thread([this, frozen = frozen_] {
+            // The sealed buffer and the old sorted array are immutable, so they are read here without locking.
+            auto merged = std::make_shared<std::vector<T>>();
+            merged->reserve(frozen->size() + buffer_capacity_);
+            mergeLevels(Tree<Entry>{}, sealed_, *frozen, [&](const T& x) { merged->push_back(x); });
+            Tree<Entry> garbage;
+            {
+                const std::lock_guard<std::mutex> guard(mutex_);
+                frozen_  = std::move(merged);
+                garbage  = std::move(sealed_);
+                merging_ = false;
+            }
+            idle_.notify_all();
+            garbage.reclaim([](Entry& x) { delete &x; });  // NOLINT(*-owning-memory)
+        });
+    }
+
+    /// Visits the union of all levels in order in linear time, where the upper levels shadow the lower ones.
+    template <typename Vis>
+    void mergeLevels(const Tree<Entry>&    upper,
+                     const Tree<Entry>&    lower,
+                     const std::vector<T>& frozen,
+                     const Vis&            visitor) const
+    {
+        const Entry* a  = upper.min();
+        const Entry* b  = lower.min();
+        auto         it = frozen.begin();
+        while ((a != nullptr) || (b != nullptr) || (it != frozen.end()))
+        {
+            // Find the smallest value among the heads of the levels; on a tie, the uppermost level wins.
+            const T* best = nullptr;
+            bool     tomb = false;
+            for (const Entry* const e : {a, b})
+            {
+                if ((e != nullptr) && ((best == nullptr) || compare_.less()(e->value, *best)))
+                {
+                    best = &e->value;
+                    tomb = e->tombstone;
+                }
+            }
+            if ((it != frozen.end()) && ((best == nullptr) || compare_.less()(*it, *best)))
+            {
+                best = &*it;
+                tomb = false;
+            }
+            CAVL_ASSERT(best != nullptr);
+            if (!tomb)
+            {
+                visitor(*best);
+            }
+            // Advance all levels positioned at an equivalent value. The value referenced by best stays valid.
+            const T& key = *best;
+            if ((a != nullptr) && (compare_(key, a->value) == 0))
+            {
+                a = a->getNextInOrderNode();
+            }
+            if ((b != nullptr) && (compare_(key, b->value) == 0))
+            {
+                b = b->getNextInOrderNode();
+            }
+            if ((it != frozen.end()) && (compare_(key, *it) == 0))
+            {
+                ++it;
+            }
+        }
+    }
+
+    const std::size_t               buffer_capacity_;
+    const detail::ThreeWay<Compare> compare_;
+
+    mutable std::mutex              mutex_;
+    mutable std::condition_variable idle_;
+    Tree<Entry>                     active_;
+    std::size_t                     active_size_ = 0;
+    Tree<Entry>                     sealed_;
+    Frozen                          frozen_;
+    bool                            merging_ = false;
+    std::thread                     worker_;
+};
+
+/// An ordered set of values that adapts its layout to the workload phases for faster lookups.
+///
+/// The values are kept in a cavl tree that absorbs the writes. Once no writes have occurred for the specified quiet
+/// period, a background thread copies the values into a read-only snapshot stored in the Eytzinger (BFS) order,
+/// where the top of the implicit search tree is packed densely into a few cache lines and the descent is
+/// branch-free. The lookups are then served from the snapshot, which is published atomically, without taking the
+/// lock, so concurrent readers do not contend. The next write discards the snapshot and the lookups return to
+/// the tree until the writes go quiet again. The caller does not need to manage the phases; the set only requires
+/// T to be copyable.
+///
+/// All operations are thread-safe.
+template <typename T, typename Compare = std::less<T>>
+class AutoFreezing final
+{
+public:
+    explicit AutoFreezing(const std::chrono::steady_clock::duration quiet_period,
+                          const Compare&                            compare = Compare{}) :
+        quiet_period_(quiet_period), compare_(compare), last_write_(std::chrono::steady_clock::now())
+    {
+        worker_ = std::thread([this] { run(); });
+    }
+
+    ~AutoFreezing()
+    {
+        {
+            const std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        worker_.join();
+        tree_.reclaim([](Entry& x) { delete &x; });  // NOLINT(*-owning-memory)
+    }
+
+    AutoFreezing(const AutoFreezing&)                    = delete;
+    AutoFreezing(AutoFreezing&&)                         = delete;
+    auto operator=(const AutoFreezing&) -> AutoFreezing& = delete;
+    auto operator=(AutoFreezing&&) -> AutoFreezing&      = delete;
+
+    /// An equivalent value, if present, is replaced. Returns true if the value was not present before.
+    auto insert(T value) -> bool
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        Entry* created = nullptr;
+        Entry* entry   = std::get<0>(tree_.search([&](const Entry& x) { return compare_(value, x.value); },
+                                                [&] {
+                                                    created = new Entry(std::move(value));  // NOLINT
+                                                    return created;
+                                                }));
+        if (entry != created)
+        {
+            entry->value = std::move(value);
+        }
+        else
+        {
+            size_++;
+        }
+        touch();
+        return entry == created;
+    }
+
+    /// Returns true if the value was found and removed.
+    auto remove(const T& key) -> bool
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        Entry* const entry = tree_.search([&](const Entry& x) { return compare_(key, x.value); });
+        if (entry == nullptr)
+        {
+            return false;
+        }
+        tree_.remove(entry);
+        delete entry;  // NOLINT(*-owning-memory)
+        size_--;
+        touch();
+        return true;
+    }
+
+    /// If the value is found, the visitor is invoked with a const reference to it and true is returned.
+    /// The visitor may be invoked after the value is removed from the set by a concurrent writer.
+    template <typename Vis>
+    auto find(const T& key, const Vis& visitor) const -> bool
+    {
+        if (const Snapshot snapshot = loadSnapshot())  // The snapshot is immutable and kept alive by the reference.
+        {
+            if (const T* const value = searchSnapshot(*snapshot, key))
+            {
+                visitor(*value);
+                return true;
+            }
+            return false;
+        }
+        const std::lock_guard<std::mutex> lock(mutex_);
+        if (const Entry* const entry = tree_.search([&](const Entry& x) { return compare_(key, x.value); }))
+        {
+            visitor(entry->value);
+            return true;
+        }
+        return false;
+    }
+    auto contains(const T& key) const -> bool
+    {
+        return find(key, [](const T& /*unused*/) {});
+    }
+
+    auto size() const -> std::size_t
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        return size_;
+    }
+
+    /// True if the lookups are currently served from the snapshot.
+    auto isFrozen() const -> bool { return loadSnapshot() != nullptr; }
+
+    /// The number of snapshots published so far. A snapshot observed by isFrozen() is already counted.
+    auto getFreezeCount() const noexcept -> std::uint64_t { return freeze_count_.load(std::memory_order_relaxed); }
+
+private:
+    class Entry final : public Node<Entry>
+    {
+    public:
+        explicit Entry(T&& val) : value(std::move(val)) {}
+        using Node<Entry>::getNextInOrderNode;
+
+        T value;
+    };
+
+    /// The values in the Eytzinger order: the children of the element at index i are at 2i+1 and 2i+2.
+    using Snapshot = std::shared_ptr<const std::vector<T>>;
+
+    /// The number of values copied per acquisition of the lock when taking the snapshot.
+    static constexpr std::size_t CopyChunkSize = 1024;
+
+    /// The snapshot is published atomically, so that the readers do not need the lock to pick it up.
+    auto loadSnapshot() const -> Snapshot
+    {
+#if defined(__cpp_lib_atomic_shared_ptr) && (__cpp_lib_atomic_shared_ptr >= 201711L)
+        return snapshot_.load(std::memory_order_acquire);
+#else
+        return std::atomic_load_explicit(&snapshot_, std::memory_order_acquire);
+#endif
+    }
+    void storeSnapshot(Snapshot snapshot)
+    {
+#if defined(__cpp_lib_atomic_shared_ptr) && (__cpp_lib_atomic_shared_ptr >= 201711L)
+        snapshot_.store(std::move(snapshot), std::memory_order_release);
+#else
+        std::atomic_store_explicit(&snapshot_, std::move(snapshot), std::memory_order_release);
+#endif
+    }
+
+    /// Invalidates the snapshot and restarts the quiet period. The lock shall be held by the caller.
+    /// The worker only needs to be woken up if it is idle, which is when the snapshot exists; otherwise, it is
+    /// either waiting for the quiet period to expire, which it rechecks on its own, or building a snapshot that
+    /// the version change will render stale.
+    void touch()
+    {
+        const bool idle = loadSnapshot() != nullptr;
+        if (idle)
+        {
+            storeSnapshot(nullptr);
+        }
+        last_write_ = std::chrono::steady_clock::now();
+        version_++;
+        if (idle)
+        {
+            wake_.notify_one();
+        }
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_)
+        {
+            if (loadSnapshot() != nullptr)
+            {
+                wake_.wait(lock);  // Nothing to do until the next write.
+                continue;
+            }
+            const auto deadline = last_write_ + quiet_period_;
+            if (std::chrono::steady_clock::now() < deadline)
+            {
+                (void) wake_.wait_until(lock, deadline);
+                continue;
+            }
+            // Only the copying is done under the lock, in chunks, so that the operations are not stalled for the
+            // whole copy; the layout is built concurrently with the other operations. The next node stays valid
+            // while the lock is released unless the set is modified, in which case the snapshot is abandoned.
+            const std::uint64_t version = version_;
+            std::vector<T>      sorted;
+            sorted.reserve(size_);
+            const Entry* cursor = tree_.min();
+            for (;;)
+            {
+                for (std::size_t i = 0; (i < CopyChunkSize) && (cursor != nullptr); i++)
+                {
+                    sorted.push_back(cursor->value);
+                    cursor = cursor->getNextInOrderNode();
+                }
+                if (cursor == nullptr)
+                {
+                    break;
+                }
+                lock.unlock();
+                lock.lock();
+                if ((version != version_) || stop_)
+                {
+                    break;
+                }
+            }
+            if (cursor != nullptr)
+            {
+                continue;  // Abandoned.
+            }
+            lock.unlock();
+            std::vector<std::size_t> order(sorted.size());
+            std::size_t              next = 0;
+            layout(order, next, 0);
+            auto snapshot = std::make_shared<std::vector<T>>();
+            snapshot->reserve(sorted.size());
+            for (const std::size_t i : order)
+            {
+                snapshot->push_back(std::move(sorted[i]));
+            }
+            lock.lock();
+            if (version == version_)  // Otherwise, the set has been modified meanwhile, so the snapshot is stale.
+            {
+                freeze_count_.store(freeze_count_.load(std::memory_order_relaxed) + 1U, std::memory_order_relaxed);
+                storeSnapshot(std::move(snapshot));
+            }
+        }
+    }
+
+    /// Maps the Eytzinger positions to the sorted positions by an in-order walk of the implicit tree.
+    static void layout(std::vector<std::size_t>& order, std::size_t& next, const std::size_t index)
+    {
+        if (index < order.size())
+        {
+            layout(order, next, (2U * index) + 1U);
+            order[index] = next++;
+            layout(order, next, (2U * index) + 2U);
+        }
+    }
+
+    /// The descent does not branch on the comparison result; the lower bound is recovered from the final index.
+    auto searchSnapshot(const std::vector<T>& values, const T& key) const -> const T*
+    {
+        const std::size_t size  = values.size();
+        std::size_t       index = 1;  // One-based index here to simplify the arithmetic.
+        while (index <= size)
+        {
+            index = (2U * index) + static_cast<std::size_t>(compare_.less()(values[index - 1U], key));
+        }
+        // Strip the trailing right turns and the last left turn to arrive at the lower bound.
+        while ((index & 1U) != 0U)
+        {
+            index >>= 1U;
+        }
+        index >>= 1U;
+        if ((index == 0U) || compare_.less()(key, values[index - 1U]))
+        {
+            return nullptr;
+        }
+        return &values[index - 1U];
+    }
+
+    const std::chrono::steady_clock::duration quiet_period_;
+    const detail::ThreeWay<Compare>           compare_;
+
+    mutable std::mutex                    mutex_;
+    std::condition_variable               wake_;
+    Tree<Entry>                           tree_;
+    std::size_t                           size_ = 0;
+#if defined(__cpp_lib_atomic_shared_ptr) && (__cpp_lib_atomic_shared_ptr >= 201711L)
+    std::atomic<Snapshot>                 snapshot_;
+#else
+    Snapshot                              snapshot_;
+#endif
+    std::chrono::steady_clock::time_point last_write_;
+    std::uint64_t                         version_ = 0;
+    bool                                  stop_    = false;
+    std::atomic<std::uint64_t>            freeze_count_{0};
+    std::thread                           worker_;
+};
+
+/// A background thread that tears down detached trees, so that destroying a large tree does not block the caller.
+///
+/// A tree is handed over by moving it into submit(), which detaches all nodes from the original instance in constant
+/// time; the original can be reused immediately. The worker frees the nodes using Tree<>::reclaim(), which walks
+/// the tree in post-order without a stack, in chunks of the configured size. The pending trees are served
+/// round-robin one chunk at a time, so a huge tree does not delay the teardown of the small ones submitted after it.
+/// The returned future becomes ready when the tree is empty; if the visitor throws, the exception is delivered via
+/// the future and the remaining nodes of that tree are abandoned.
+///
+/// The destructor completes all pending work before returning. The visitor is invoked on the worker thread.
+class Reclaimer final
+{
+public:
+    explicit Reclaimer(const std::size_t chunk_size = 4096) : chunk_size_(chunk_size)
+    {
+        CAVL_ASSERT(chunk_size > 0U);
+        worker_ = std::thread([this] { run(); });
+    }
+
+    ~Reclaimer()
+    {
+        {
+            const std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_one();
+        worker_.join();
+    }
+
+    Reclaimer(const Reclaimer&)                    = delete;
+    Reclaimer(Reclaimer&&)                         = delete;
+    auto operator=(const Reclaimer&) -> Reclaimer& = delete;
+    auto operator=(Reclaimer&&) -> Reclaimer&      = delete;
+
+    /// The visitor receives each node after it has been unlinked from the tree, so it may destroy the node.
+    template <typename Derived, typename Vis>
+    auto submit(Tree<Derived>&& tree, Vis visitor) -> std::future<void>
+    {
+        auto orphan = std::make_shared<Tree<Derived>>(std::move(tree));
+        Job  job{[orphan, visitor = std::move(visitor)](const std::size_t budget) {
+                     return orphan->reclaim(visitor, budget);
+                 },
+                 std::promise<void>{}};
+        auto out = job.done.get_future();
+        {
+            const std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(std::move(job));
+        }
+        wake_.notify_one();
+        return out;
+    }
+
+    /// The number of trees that are not yet fully reclaimed.
+    auto getPendingCount() const -> std::size_t
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        return jobs_.size() + active_;
+    }
+
+private:
+    struct Job final
+    {
+        std::function<bool(std::size_t)> step;  ///< Reclaims up to the specified number of nodes; true when done.
+        std::promise<void>               done;
+    };
+
+    void run()
+    {
+        std::vector<Job>             active;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            wake_.wait(lock, [this, &active] { return stop_ || (!jobs_.empty()) || (!active.empty()); });
+            std::move(jobs_.begin(), jobs_.end(), std::back_inserter(active));
+            jobs_.clear();
+            active_ = active.size();
+            if (active.empty())
+            {
+                break;  // Stopping and there is nothing left to do.
+            }
+            lock.unlock();
+            for (std::size_t i = 0; i < active.size();)
+            {
+                Job& job = active[i];
+                try
+                {
+                    if (!job.step(chunk_size_))
+                    {
+                        i++;
+                        continue;
+                    }
+                    job.done.set_value();
+                }
+                catch (...)
+                {
+                    job.done.set_exception(std::current_exception());
+                }
+                if (&job != &active.back())
+                {
+                    job = std::move(active.back());
+                }
+                active.pop_back();
+            }
+            lock.lock();
+            active_ = active.size();
+        }
+    }
+
+    const std::size_t chunk_size_;
+
+    mutable std::mutex      mutex_;
+    std::condition_variable wake_;
+    std::vector<Job>        jobs_;
+    std::size_t             active_ = 0;
+    bool                    stop_   = false;
+    std::thread             worker_;
+};
+
+#if defined(CAVL_PROFILING) && CAVL_PROFILING
+
+/// Returns the current value of a fast monotonic counter: the time stamp counter on x86, the virtual counter on
+/// AArch64, or the steady clock in nanoseconds elsewhere. The unit is platform-specific.
+inline auto readCycleCounter() noexcept -> std::uint64_t
+{
+#    if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#    elif defined(__aarch64__)
+    std::uint64_t out = 0;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(out));  // NOLINT(hicpp-no-assembler)
+    return out;
+#    else
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+#    endif
+}
+
+/// A histogram of 64-bit values with log-linear buckets, in the spirit of HdrHistogram: values below 64 are
+/// recorded exactly, larger values are recorded with the relative error under 1/32 (about three percent).
+/// The memory footprint is fixed and independent of the number or the range of the recorded values.
+class Histogram final
+{
+public:
+    static constexpr std::size_t SubBucketBits  = 5;
+    static constexpr std::size_t SubBucketCount = 1U << SubBucketBits;
+    static constexpr std::size_t BucketCount    = (64U - SubBucketBits + 1U) * SubBucketCount;
+
+    Histogram() : buckets_(BucketCount, 0U) {}
+
+    void record(const std::uint64_t value, const std::uint64_t count = 1)
+    {
+        if (count > 0U)
+        {
+            buckets_[getBucketIndex(value)] += count;
+            count_ += count;
+            min_ = std::min(min_, value);
+            max_ = std::max(max_, value);
+        }
+    }
+
+    void merge(const Histogram& other)
+    {
+        for (std::size_t i = 0; i < BucketCount; i++)
+        {
+            buckets_[i] += other.buckets_[i];
+        }
+        count_ += other.count_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void reset()
+    {
+        std::fill(buckets_.begin(), buckets_.end(), 0U);
+        count_ = 0;
+        min_   = std::numeric_limits<std::uint64_t>::max();
+        max_   = 0;
+    }
+
+    auto getCount() const noexcept { return count_; }
+
+    /// The minimum and the maximum are exact. Both are zero if the histogram is empty.
+    auto getMin() const noexcept { return (count_ > 0U) ? min_ : 0U; }
+    auto getMax() const noexcept { return max_; }
+
+    /// Returns the smallest value such that the specified fraction (in [0, 1]) of the recorded values are not
+    /// greater than it, within the precision of the histogram. Zero if the histogram is empty.
+    auto getPercentile(const double fraction) const -> std::uint64_t
+    {
+        if (count_ == 0U)
+        {
+            return 0;
+        }
+        const double clamped = std::min(std::max(fraction, 0.0), 1.0);
+        const auto   rank    = std::max<std::uint64_t>(
+            1U,
+            static_cast<std::uint64_t>(std::ceil(clamped * static_cast<double>(count_))));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < BucketCount; i++)
+        {
+            seen += buckets_[i];
+            if (seen >= rank)
+            {
+                return std::min(std::max(getBucketUpperBound(i), min_), max_);
+            }
+        }
+        return max_;
+    }
+
+    static auto getBucketIndex(const std::uint64_t value) noexcept -> std::size_t
+    {
+        if (value < (2U * SubBucketCount))
+        {
+            return static_cast<std::size_t>(value);
+        }
+        std::size_t msb = 0;
+        for (std::uint64_t x = value; x > 1U; x >>= 1U)
+        {
+            msb++;
+        }
+        const std::size_t shift = msb - SubBucketBits;
+        return ((shift + 1U) * SubBucketCount) + static_cast<std::size_t>(value >> shift) - SubBucketCount;
+    }
+
+    static auto getBucketUpperBound(const std::size_t index) noexcept -> std::uint64_t
+    {
+        if (index < (2U * SubBucketCount))
+        {
+            return index;
+        }
+        const std::size_t   shift    = (index / SubBucketCount) - 1U;
+        const std::uint64_t mantissa = (index % SubBucketCount) + SubBucketCount;
+        return ((mantissa + 1U) << shift) - 1U;
+    }
+
+private:
+    std::vector<std::uint64_t> buckets_;
+    std::uint64_t              count_ = 0;
+    std::uint64_t              min_   = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t              max_   = 0;
+};
+
+/// A cavl::Profiler that measures the duration of one in every N operations performed by each thread using
+/// readCycleCounter(). The measurements are stored into a lock-free single-producer single-consumer ring buffer
+/// that is private to the measuring thread, so the sampling threads never contend with each other or with the
+/// reader; when a ring is full, the sample is dropped and counted. The rings are periodically collected using
+/// drain(), either sample by sample or directly into per-operation histograms.
+///
+/// The profiler is not active until it is installed using cavl::Profiler::install(); it is uninstalled
+/// automatically upon destruction. The rings are owned by the profiler and outlive the threads that fill them.
+class SamplingProfiler final : public Profiler
+{
+public:
+    struct Sample final
+    {
+        const void*   tree;
+        Operation     op;
+        std::uint64_t cycles;
+    };
+
+    /// The ring capacity is the number of samples per thread; it shall be a power of two.
+    explicit SamplingProfiler(const std::uint32_t period, const std::size_t ring_capacity = 4096) :
+        period_(period), ring_capacity_(ring_capacity), id_(getNextID())
+    {
+        CAVL_ASSERT(period > 0U);
+        CAVL_ASSERT((ring_capacity > 0U) && ((ring_capacity & (ring_capacity - 1U)) == 0U));
+    }
+
+    ~SamplingProfiler()
+    {
+        Profiler* expected = this;
+        (void) getInstalled().compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel);
+    }
+
+    SamplingProfiler(const SamplingProfiler&)                    = delete;
+    SamplingProfiler(SamplingProfiler&&)                         = delete;
+    auto operator=(const SamplingProfiler&) -> SamplingProfiler& = delete;
+    auto operator=(SamplingProfiler&&) -> SamplingProfiler&      = delete;
+
+    auto begin(const void* const tree, const Operation op) noexcept -> std::uint64_t override
+    {
+        (void) tree;
+        (void) op;
+        ThreadState& ts = getThreadState();
+        if ((ts.profiler_id == id_) && (--ts.countdown > 0U))
+        {
+            return 0;  // This is the fast path taken by the operations that are not sampled.
+        }
+        if ((ts.profiler_id != id_) && (!attach(ts)))
+        {
+            return 0;
+        }
+        ts.countdown = period_;
+        return std::max<std::uint64_t>(readCycleCounter(), 1U);  // Zero means that the operation is not sampled.
+    }
+
+    void end(const void* const tree, const Operation op, const std::uint64_t token) noexcept override
+    {
+        if (token == 0U)
+        {
+            return;  // The operation is not sampled; this is the fast path.
+        }
+        const std::uint64_t now = readCycleCounter();
+        ThreadState&        ts  = getThreadState();
+        if (ts.profiler_id == id_)
+        {
+            ts.ring->push(Sample{tree, op, now - token});
+        }
+    }
+
+    /// Removes all samples accumulated so far and invokes the sink as sink(const Sample&) on each of them.
+    /// Returns the number of samples drained. May be invoked concurrently with the sampled operations.
+    template <typename Sink>
+    auto drain(const Sink& sink) -> std::size_t
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        std::size_t                       out = 0;
+        for (const auto& ring : rings_)
+        {
+            out += ring->pop(sink);
+        }
+        return out;
+    }
+
+    /// Like the other overload, but records the duration of each sample into the histogram of its operation.
+    auto drain(std::array<Histogram, OperationCount>& histograms) -> std::size_t
+    {
+        return drain([&histograms](const Sample& s) { histograms[static_cast<std::size_t>(s.op)].record(s.cycles); });
+    }
+
+    /// The number of samples lost because the ring of the sampling thread was full.
+    auto getDropCount() const -> std::uint64_t
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        std::uint64_t                     out = 0;
+        for (const auto& ring : rings_)
+        {
+            out += ring->getDropCount();
+        }
+        return out;
+    }
+
+    auto getPeriod() const noexcept { return period_; }
+
+private:
+    class Ring final
+    {
+    public:
+        Ring(const std::thread::id owner, const std::size_t capacity) :
+            owner_(owner), mask_(capacity - 1U), buffer_(std::make_unique<Sample[]>(capacity))
+        {}
+
+        /// Invoked by the owning thread only.
+        void push(const Sample& sample) noexcept
+        {
+            const std::size_t head = head_.load(std::memory_order_relaxed);
+            if ((head - tail_.load(std::memory_order_acquire)) > mask_)
+            {
+                drops_.store(drops_.load(std::memory_order_relaxed) + 1U, std::memory_order_relaxed);
+                return;
+            }
+            buffer_[head & mask_] = sample;
+            head_.store(head + 1U, std::memory_order_release);
+        }
+
+        /// Invoked by one consumer at a time.
+        template <typename Sink>
+        auto pop(const Sink& sink) -> std::size_t
+        {
+            const std::size_t tail = tail_.load(std::memory_order_relaxed);
+            const std::size_t head = head_.load(std::memory_order_acquire);
+            for (std::size_t i = tail; i != head; i++)
+            {
+                sink(static_cast<const Sample&>(buffer_[i & mask_]));
+            }
+            tail_.store(head, std::memory_order_release);
+            return head - tail;
+        }
+
+        auto getOwner() const noexcept -> std::thread::id { return owner_; }
+        auto getDropCount() const noexcept -> std::uint64_t { return drops_.load(std::memory_order_relaxed); }
+
+    private:
+        const std::thread::id     owner_;
+        const std::size_t         mask_;
+        std::unique_ptr<Sample[]> buffer_;  // NOLINT(*-avoid-c-arrays)
+
+        alignas(CacheLineSize) std::atomic<std::size_t> head_{0};
+        std::atomic<std::uint64_t> drops_{0};
+        alignas(CacheLineSize) std::atomic<std::size_t> tail_{0};
+    };
+
+    /// The sampling state of the current thread is associated with one profiler at a time, identified by its
+    /// unique ID rather than the address to prevent confusion with a destroyed profiler at the same address.
+    struct ThreadState final
+    {
+        std::uint64_t profiler_id = 0;
+        std::uint32_t countdown   = 0;
+        Ring*         ring        = nullptr;
+    };
+
+    static auto getThreadState() noexcept -> ThreadState&
+    {
+        thread_local ThreadState state;
+        return state;
+    }
+
+    static auto getNextID() noexcept -> std::uint64_t
+    {
+        static std::atomic<std::uint64_t> counter{0};
+        return counter.fetch_add(1U, std::memory_order_relaxed) + 1U;
+    }
+
+    /// Finds or creates the ring of the current thread. Returns false if the ring could not be allocated.
+    auto attach(ThreadState& ts) noexcept -> bool
+    {
+        try
+        {
+            const std::lock_guard<std::mutex> lock(mutex_);
+            const auto                        self = std::this_thread::get_id();
+            const auto it = std::find_if(rings_.begin(), rings_.end(), [self](const std::unique_ptr<Ring>& x) {
+                return x->getOwner() == self;
+            });
+            if (it != rings_.end())
+            {
+                ts.ring = it->get();
+            }
+            else
+            {
+                rings_.push_back(std::make_unique<Ring>(self, ring_capacity_));
+                ts.ring = rings_.back().get();
+            }
+            ts.profiler_id = id_;
+            return true;
+        } catch (...)
+        {
+            return false;
+        }
+    }
+
+    const std::uint32_t                period_;
+    const std::size_t                  ring_capacity_;
+    const std::uint64_t                id_;
+    mutable std::mutex                 mutex_;
+    std::vector<std::unique_ptr<Ring>> rings_;
+};
+
+#endif
+
+}  // namespace cavl
+
+// NOLINTEND(cppcoreguidelines-pro-bounds-constant-array-index)
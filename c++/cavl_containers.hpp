@@ -0,0 +1,892 @@
+/// Source: https://github.com/pavel-kirienko/cavl
+///
+/// This is an optional companion to cavl.hpp providing specialized single-threaded containers built on top of
+/// cavl::Tree. Unlike the core header, it requires C++17 and dynamic memory, but not the thread support library;
+/// see cavl_concurrent.hpp for the containers that are safe to share between threads.
+///
+/// Copyright (c) 2021 Pavel Kirienko <pavel@uavcan.org>
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+/// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+/// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+/// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+/// the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+/// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+/// OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+/// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include "cavl.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if __cplusplus < 201703L
+#    error "cavl_containers.hpp requires C++17 or newer"
+#endif
+
+// NOLINTBEGIN(cppcoreguidelines-pro-bounds-constant-array-index)
+
+namespace cavl
+{
+namespace detail
+{
+/// Turns the strict weak ordering used by the containers into the three-way comparison expected by the tree search.
+template <typename Compare>
+class ThreeWay final
+{
+public:
+    explicit ThreeWay(const Compare& compare) : compare_(compare) {}
+
+    /// Returns a negative value if a precedes b, positive if b precedes a, and zero if they are equivalent.
+    template <typename A, typename B>
+    auto operator()(const A& a, const B& b) const -> int
+    {
+        if (compare_(a, b))
+        {
+            return -1;
+        }
+        return compare_(b, a) ? +1 : 0;
+    }
+
+    /// The original ordering, for the standard algorithms and where the equivalence need not be distinguished.
+    auto less() const noexcept -> const Compare& { return compare_; }
+
+private:
+    Compare compare_;
+};
+}  // namespace detail
+
+/// An ordered set whose tree nodes are kept in the van Emde Boas order in memory under updates, so that the searches
+/// touch O(log_B n) cache lines for any cache line size B, and which does not degrade with churn like a tree whose
+/// nodes are allocated one by one from the heap.
+///
+/// The nodes live in a packed-memory array: a slot array with evenly spread gaps, divided into segments of
+/// O(log n) slots. Whenever the array is resized, the nodes are laid out in the exact van Emde Boas order of the
+/// current tree shape: the top half of the tree levels first, recursively, followed by each of the subtrees hanging
+/// off the top half, recursively. A new node is placed next to its parent, where it also belongs in the van Emde
+/// Boas order of the new shape, by shifting the nodes within the segment toward the nearest gap. If the segment is
+/// full, the smallest enclosing aligned window whose density is below its threshold is respawned with even gaps;
+/// the thresholds loosen toward the smaller windows as in the classic packed-memory array, which bounds the number
+/// of node moves per insertion by amortized O(log^2 n). If even the whole array is too dense, it is grown.
+/// Removals leave gaps; the array is shrunk when it becomes sparse. Rotations do not move the nodes, so the layout
+/// is only approximately valid between resizes, while the relative order of the nodes in memory is preserved.
+///
+/// The nodes are relocated using the move constructor of cavl::Node, which relinks the neighbors in constant time.
+/// The container is not thread-safe.
+template <typename T, typename Compare = std::less<T>>
+class CacheOblivious final
+{
+public:
+    explicit CacheOblivious(const Compare& compare = Compare{}) : compare_(compare) {}
+
+    ~CacheOblivious()
+    {
+        for (std::size_t i = 0; i < capacity_; i++)
+        {
+            if (occupied_[i])
+            {
+                at(i)->~Entry();
+            }
+        }
+    }
+
+    CacheOblivious(const CacheOblivious&)                    = delete;
+    CacheOblivious(CacheOblivious&&)                         = delete;
+    auto operator=(const CacheOblivious&) -> CacheOblivious& = delete;
+    auto operator=(CacheOblivious&&) -> CacheOblivious&      = delete;
+
+    /// An equivalent value, if present, is replaced. Returns true if the value was not present before.
+    auto insert(T value) -> bool
+    {
+        const auto predicate = [&](const Entry& x) { return compare_(value, x.value); };
+        if (Entry* const entry = tree_.search(predicate))
+        {
+            entry->value = std::move(value);
+            return false;
+        }
+        const std::size_t slot = allocate(predicate);
+        (void) tree_.search(predicate, [&] {
+            Entry* const entry = new (&slots_[slot]) Entry(std::move(value));
+            occupied_[slot]    = true;  // Only once the entry is constructed, in case the constructor throws.
+            return entry;
+        });
+        size_++;
+        return true;
+    }
+
+    /// Returns true if the value was found and removed.
+    auto remove(const T& key) -> bool
+    {
+        Entry* const entry = tree_.search([&](const Entry& x) { return compare_(key, x.value); });
+        if (entry == nullptr)
+        {
+            return false;
+        }
+        tree_.remove(entry);
+        occupied_[indexOf(entry)] = false;
+        entry->~Entry();
+        size_--;
+        if ((capacity_ > MinCapacity) && ((size_ * 8U) < capacity_))
+        {
+            relayout(capacity_ / 2U);
+        }
+        return true;
+    }
+
+    /// If the value is found, the visitor is invoked with a const reference to it and true is returned.
+    template <typename Vis>
+    auto find(const T& key, const Vis& visitor) const -> bool
+    {
+        if (const Entry* const entry = tree_.search([&](const Entry& x) { return compare_(key, x.value); }))
+        {
+            visitor(entry->value);
+            return true;
+        }
+        return false;
+    }
+    auto contains(const T& key) const -> bool
+    {
+        return find(key, [](const T& /*unused*/) {});
+    }
+
+    /// Visits all values in order. The visitor shall not modify the set.
+    template <typename Vis>
+    void traverse(const Vis& visitor) const
+    {
+        tree_.traverseInOrder([&visitor](const Entry& x) { visitor(x.value); });
+    }
+
+    auto size() const noexcept -> std::size_t { return size_; }
+    auto empty() const noexcept -> bool { return size_ == 0U; }
+
+    /// The number of slots in the packed-memory array and the total number of node moves performed so far.
+    auto getCapacity() const noexcept -> std::size_t { return capacity_; }
+    auto getMoveCount() const noexcept -> std::uint64_t { return moves_; }
+
+private:
+    static constexpr std::size_t MinCapacity = 16;
+    static constexpr double      RootDensity = 0.75;  ///< The density threshold of the whole array.
+
+    class Entry final : public Node<Entry>
+    {
+    public:
+        explicit Entry(T&& val) : value(std::move(val)) {}
+        using Node<Entry>::getChildNode;
+
+        T value;
+    };
+
+    /// Raw storage for one entry; the occupancy is tracked separately to keep the slots as small as the entries.
+    struct Slot final
+    {
+        alignas(Entry) unsigned char bytes[sizeof(Entry)];  // NOLINT(*-avoid-c-arrays)
+    };
+
+    // NOLINTBEGIN(*-reinterpret-cast) the entries are constructed in place in the slots.
+    auto at(const std::size_t index) -> Entry* { return std::launder(reinterpret_cast<Entry*>(&slots_[index])); }
+    auto indexOf(const Entry* const entry) const -> std::size_t
+    {
+        return static_cast<std::size_t>(reinterpret_cast<const Slot*>(entry) - slots_.get());
+    }
+    // NOLINTEND(*-reinterpret-cast)
+
+    /// Returns an empty slot next to the slot of the future parent of the new node, or any empty slot if the tree
+    /// is empty. If the segment of the parent is full, the gaps are evened out in the smallest enclosing window that
+    /// is sparse enough, or, failing that, the array is grown; the parent is looked up anew after every relocation
+    /// because its address changes.
+    template <typename Pre>
+    auto allocate(const Pre& predicate) -> std::size_t
+    {
+        if (capacity_ == 0U)
+        {
+            relayout(MinCapacity);
+        }
+        bool spread_done = false;
+        for (;;)
+        {
+            const std::size_t anchor = findAnchor(predicate);
+            if (tree_.empty())
+            {
+                return anchor;  // The tree is empty, so is the array.
+            }
+            const std::size_t gap = findGap(anchor);
+            if (gap < capacity_)
+            {
+                return openGap(anchor, gap);
+            }
+            // If spreading has not opened a gap in the segment due to rounding, only growing the array will.
+            if (spread_done || (!spreadAround(anchor)))
+            {
+                relayout(capacity_ * 2U);
+            }
+            spread_done = true;
+        }
+    }
+
+    /// The slot of the future parent of the new node, or the middle of the array if the tree is empty.
+    template <typename Pre>
+    auto findAnchor(const Pre& predicate) const -> std::size_t
+    {
+        const Entry* parent = nullptr;
+        for (const Entry* n = tree_; n != nullptr; n = n->getChildNode(predicate(*n) > 0))
+        {
+            parent = n;
+        }
+        return (parent != nullptr) ? indexOf(parent) : (capacity_ / 2U);
+    }
+
+    /// Evens out the gaps in the smallest enclosing window that can accommodate one more node within its density
+    /// threshold. Returns false if there is no such window, not even the whole array.
+    auto spreadAround(const std::size_t anchor) -> bool
+    {
+        const double levels = std::log2(static_cast<double>(capacity_ / segment_));
+        for (std::size_t width = segment_ * 2U; width <= capacity_; width *= 2U)
+        {
+            const std::size_t begin     = anchor - (anchor % width);
+            const double      level     = std::log2(static_cast<double>(width / segment_));
+            const double      threshold = 1.0 - (((1.0 - RootDensity) * level) / levels);
+            const std::size_t count     = countOccupied(begin, width);
+            if (static_cast<double>(count + 1U) <= (threshold * static_cast<double>(width)))
+            {
+                spread(begin, width, count);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    auto countOccupied(const std::size_t begin, const std::size_t width) const -> std::size_t
+    {
+        return static_cast<std::size_t>(std::count(occupied_.begin() + static_cast<std::ptrdiff_t>(begin),
+                                                   occupied_.begin() + static_cast<std::ptrdiff_t>(begin + width),
+                                                   true));
+    }
+
+    /// Returns the gap in the segment of the anchor that is nearest to it, preferring the gaps that follow it,
+    /// or the capacity if the segment is full.
+    auto findGap(const std::size_t anchor) const -> std::size_t
+    {
+        const std::size_t begin = anchor - (anchor % segment_);
+        for (std::size_t gap = anchor + 1U; gap < (begin + segment_); gap++)
+        {
+            if (!occupied_[gap])
+            {
+                return gap;
+            }
+        }
+        for (std::size_t gap = anchor; gap-- > begin;)
+        {
+            if (!occupied_[gap])
+            {
+                return gap;
+            }
+        }
+        return capacity_;
+    }
+
+    /// Frees a slot adjacent to the anchor by shifting the nodes between it and the specified gap toward the gap.
+    auto openGap(const std::size_t anchor, const std::size_t gap) -> std::size_t
+    {
+        if (gap > anchor)
+        {
+            for (std::size_t i = gap; i > (anchor + 1U); i--)
+            {
+                move(i - 1U, i);
+            }
+            return anchor + 1U;
+        }
+        for (std::size_t i = gap; i < anchor; i++)
+        {
+            move(i + 1U, i);
+        }
+        return anchor;
+    }
+
+    void move(const std::size_t from, const std::size_t to)
+    {
+        CAVL_ASSERT(occupied_[from] && !occupied_[to]);
+        Entry* const entry = at(from);
+        new (&slots_[to]) Entry(std::move(*entry));  // The tree is relinked by the move constructor of the node.
+        entry->~Entry();
+        occupied_[from] = false;
+        occupied_[to]   = true;
+        moves_++;
+    }
+
+    /// Evens out the gaps within the window while preserving the order of the nodes.
+    void spread(const std::size_t begin, const std::size_t width, const std::size_t count)
+    {
+        std::vector<Entry> buffer;
+        buffer.reserve(count);  // No reallocation, so the nodes stay linked correctly while in the buffer.
+        for (std::size_t i = begin; i < (begin + width); i++)
+        {
+            if (occupied_[i])
+            {
+                Entry* const entry = at(i);
+                buffer.push_back(std::move(*entry));
+                entry->~Entry();
+                occupied_[i] = false;
+            }
+        }
+        for (std::size_t i = 0; i < buffer.size(); i++)
+        {
+            const std::size_t to = begin + ((i * width) / buffer.size());
+            new (&slots_[to]) Entry(std::move(buffer[i]));
+            occupied_[to] = true;
+        }
+        moves_ += 2U * buffer.size();
+    }
+
+    /// Moves all nodes into a new array of the specified capacity in the van Emde Boas order of the tree shape.
+    void relayout(const std::size_t capacity)
+    {
+        std::vector<Entry*> order;
+        order.reserve(size_);
+        collect(tree_, getHeight(tree_), order);
+        std::unique_ptr<Slot[]> slots(new Slot[capacity]);  // NOLINT(*-avoid-c-arrays)
+        std::vector<bool>       occupied(capacity, false);
+        for (std::size_t i = 0; i < order.size(); i++)
+        {
+            const std::size_t to = (i * capacity) / order.size();
+            new (&slots[to]) Entry(std::move(*order[i]));
+            order[i]->~Entry();
+            occupied[to] = true;
+        }
+        moves_ += order.size();
+        slots_    = std::move(slots);
+        occupied_ = std::move(occupied);
+        capacity_ = capacity;
+        // The segment size is the smallest power of two not less than log2(capacity), but at least 8.
+        segment_ = 8U;
+        while ((segment_ < capacity) && (static_cast<double>(segment_) < std::log2(static_cast<double>(capacity))))
+        {
+            segment_ *= 2U;
+        }
+    }
+
+    static auto getHeight(const Entry* const root) -> std::size_t
+    {
+        return (root == nullptr) ? 0U : (1U + std::max(getHeight(root->getChildNode(false)),
+                                                       getHeight(root->getChildNode(true))));
+    }
+
+    /// Appends the nodes of the subtree down to the specified height in the van Emde Boas order.
+    static void collect(Entry* const root, const std::size_t height, std::vector<Entry*>& out)
+    {
+        if ((root == nullptr) || (height == 0U))
+        {
+            return;
+        }
+        if (height == 1U)
+        {
+            out.push_back(root);
+            return;
+        }
+        const std::size_t top = height / 2U;
+        collect(root, top, out);
+        collectBottom(root, top, height - top, out);
+    }
+
+    /// Lays out each subtree rooted at the specified depth below the root, in order.
+    static void collectBottom(Entry* const         root,
+                              const std::size_t    depth,
+                              const std::size_t    height,
+                              std::vector<Entry*>& out)
+    {
+        if (root == nullptr)
+        {
+            return;
+        }
+        if (depth == 0U)
+        {
+            collect(root, height, out);
+            return;
+        }
+        collectBottom(root->getChildNode(false), depth - 1U, height, out);
+        collectBottom(root->getChildNode(true), depth - 1U, height, out);
+    }
+
+    const detail::ThreeWay<Compare> compare_;
+
+    Tree<Entry>             tree_;
+    std::unique_ptr<Slot[]> slots_;  // NOLINT(*-avoid-c-arrays)
+    std::vector<bool>       occupied_;
+    std::size_t             capacity_ = 0;
+    std::size_t             segment_  = 0;
+    std::size_t             size_     = 0;
+    std::uint64_t           moves_    = 0;
+};
+
+/// A two-dimensional orthogonal range tree for slowly changing point sets that are rebuilt in batches.
+///
+/// The primary structure is a cavl tree of all points keyed by the x coordinate. Every node of the primary tree
+/// owns an array of the points of its subtree sorted by y, where each entry also holds the positions of the first
+/// not-smaller entries in the arrays of both children (fractional cascading). A query finds the lower y bound by
+/// binary search only once, at the node where the search paths of the x bounds split, and then follows the
+/// cascading links down both paths, enumerating the canonical subtrees hanging off the paths from their arrays.
+/// A query therefore takes O(log n + k) time, where k is the number of reported points, while the memory footprint
+/// and the rebuild time are O(n log n).
+///
+/// GetX and GetY are function objects returning the coordinates of a point, which are ordered by operator<.
+/// Points with equal coordinates are allowed. The container is not thread-safe; concurrent queries are fine.
+template <typename T, typename GetX, typename GetY>
+class RangeTree2D final
+{
+public:
+    using X = std::decay_t<std::invoke_result_t<const GetX&, const T&>>;
+    using Y = std::decay_t<std::invoke_result_t<const GetY&, const T&>>;
+
+    explicit RangeTree2D(const GetX& get_x = GetX{}, const GetY& get_y = GetY{}) : get_x_(get_x), get_y_(get_y) {}
+
+    ~RangeTree2D() = default;
+
+    RangeTree2D(const RangeTree2D&)                    = delete;
+    RangeTree2D(RangeTree2D&&)                         = delete;
+    auto operator=(const RangeTree2D&) -> RangeTree2D& = delete;
+    auto operator=(RangeTree2D&&) -> RangeTree2D&      = delete;
+
+    /// Replaces the contents with the specified points in O(n log n) time.
+    void rebuild(std::vector<T> points)
+    {
+        CAVL_ASSERT(points.size() < Invalid);
+        tree_ = Tree<Column>{};
+        columns_.clear();
+        points_ = std::move(points);
+        std::vector<std::uint32_t> order(points_.size());
+        for (std::size_t i = 0; i < order.size(); i++)
+        {
+            order[i] = static_cast<std::uint32_t>(i);
+        }
+        std::sort(order.begin(), order.end(), [this](const std::uint32_t a, const std::uint32_t b) {
+            return lessX(a, b);
+        });
+        // The columns are never relocated because the storage is reserved in advance.
+        columns_.reserve(order.size());
+        for (const std::uint32_t point : order)
+        {
+            (void) tree_.search([&](const Column& x) { return lessX(point, x.point) ? -1 : +1; },
+                                [&] {
+                                    columns_.emplace_back(point);
+                                    return &columns_.back();
+                                });
+        }
+        // The children are visited before their parent, so their arrays are ready to be merged.
+        tree_.traversePostOrder([this](Column& x) { merge(x); });
+    }
+
+    /// Invokes the visitor with a const reference to every point within the closed rectangle
+    /// [x_min, x_max] x [y_min, y_max]. The order of the reported points is unspecified.
+    template <typename Vis>
+    void query(const X& x_min, const X& x_max, const Y& y_min, const Y& y_max, const Vis& visitor) const
+    {
+        // Descend to the first node inside the x range, where the paths to both x bounds diverge.
+        const Column* split = tree_;
+        while ((split != nullptr) && (isLeftOf(split->point, x_min) || isRightOf(split->point, x_max)))
+        {
+            split = split->getChildNode(isLeftOf(split->point, x_min));
+        }
+        if (split == nullptr)
+        {
+            return;
+        }
+        const auto& entries = split->entries;
+        const auto  lower   = std::partition_point(entries.begin(), entries.end() - 1, [&](const Entry& x) {
+            return get_y_(points_[x.point]) < y_min;
+        });
+        const Entry& origin = *lower;
+        visitPoint(split->point, y_min, y_max, visitor);
+        // Follow the path of each x bound. Where the path turns toward the bound, the node and the whole subtree
+        // on the inner side are within the x range, so the subtree is reported straight from its array.
+        for (const bool right : {false, true})
+        {
+            const Column* node     = split->getChildNode(right);
+            std::uint32_t position = origin.down[right];
+            while (node != nullptr)
+            {
+                const Entry& entry  = node->entries[position];
+                const bool   inside = right ? (!isRightOf(node->point, x_max)) : (!isLeftOf(node->point, x_min));
+                if (inside)
+                {
+                    visitPoint(node->point, y_min, y_max, visitor);
+                    if (const Column* const inner = node->getChildNode(!right))
+                    {
+                        visitColumn(*inner, entry.down[!right], y_max, visitor);
+                    }
+                }
+                const bool dir = inside ? right : !right;
+                position       = entry.down[dir];
+                node           = node->getChildNode(dir);
+            }
+        }
+    }
+
+    auto size() const noexcept -> std::size_t { return points_.size(); }
+    auto empty() const noexcept -> bool { return points_.empty(); }
+
+private:
+    static constexpr std::uint32_t Invalid = std::numeric_limits<std::uint32_t>::max();
+
+    /// The position of the first entry in each child array that is not less than this entry by (y, index).
+    struct Entry final
+    {
+        std::uint32_t                point;
+        std::array<std::uint32_t, 2> down;
+    };
+
+    /// The array is terminated by an entry with an invalid point holding the sizes of the child arrays.
+    class Column final : public Node<Column>
+    {
+    public:
+        explicit Column(const std::uint32_t pt) : point(pt) {}
+        using Node<Column>::getChildNode;
+
+        std::uint32_t      point;
+        std::vector<Entry> entries;
+    };
+
+    /// The points are ordered by the coordinate first and by the index next, which makes all keys unique.
+    auto lessX(const std::uint32_t a, const std::uint32_t b) const -> bool
+    {
+        const X& xa = get_x_(points_[a]);
+        const X& xb = get_x_(points_[b]);
+        return (xa < xb) || ((!(xb < xa)) && (a < b));
+    }
+    auto lessY(const std::uint32_t a, const std::uint32_t b) const -> bool
+    {
+        const Y& ya = get_y_(points_[a]);
+        const Y& yb = get_y_(points_[b]);
+        return (ya < yb) || ((!(yb < ya)) && (a < b));
+    }
+    auto isLeftOf(const std::uint32_t point, const X& x_min) const -> bool { return get_x_(points_[point]) < x_min; }
+    auto isRightOf(const std::uint32_t point, const X& x_max) const -> bool { return x_max < get_x_(points_[point]); }
+
+    /// Merges the arrays of the children and the own point of the column in linear time.
+    void merge(Column& column) const
+    {
+        std::array<const std::vector<Entry>*, 2> sources{};
+        std::array<std::uint32_t, 2>             sizes{};
+        for (const bool right : {false, true})
+        {
+            if (const Column* const child = column.getChildNode(right))
+            {
+                sources[right] = &child->entries;
+                sizes[right]   = static_cast<std::uint32_t>(child->entries.size() - 1U);
+            }
+        }
+        column.entries.clear();
+        column.entries.reserve(sizes[0] + sizes[1] + 2U);
+        std::array<std::uint32_t, 2> heads{};
+        bool                         own = true;
+        while ((heads[0] < sizes[0]) || (heads[1] < sizes[1]) || own)
+        {
+            std::uint32_t best   = own ? column.point : Invalid;
+            int           source = -1;
+            for (const bool right : {false, true})
+            {
+                if (heads[right] < sizes[right])
+                {
+                    const std::uint32_t candidate = (*sources[right])[heads[right]].point;
+                    if ((best == Invalid) || lessY(candidate, best))
+                    {
+                        best   = candidate;
+                        source = right ? 1 : 0;
+                    }
+                }
+            }
+            column.entries.push_back(Entry{best, heads});
+            if (source < 0)
+            {
+                own = false;
+            }
+            else
+            {
+                heads[static_cast<std::size_t>(source)]++;
+            }
+        }
+        column.entries.push_back(Entry{Invalid, heads});
+    }
+
+    template <typename Vis>
+    void visitPoint(const std::uint32_t point, const Y& y_min, const Y& y_max, const Vis& visitor) const
+    {
+        const T& pt = points_[point];
+        const Y& y  = get_y_(pt);
+        if ((!(y < y_min)) && (!(y_max < y)))
+        {
+            visitor(pt);
+        }
+    }
+
+    /// The entries starting from the specified position are not below the lower y bound.
+    template <typename Vis>
+    void visitColumn(const Column& column, std::uint32_t position, const Y& y_max, const Vis& visitor) const
+    {
+        for (; column.entries[position].point != Invalid; position++)
+        {
+            const T& pt = points_[column.entries[position].point];
+            if (y_max < get_y_(pt))
+            {
+                break;
+            }
+            visitor(pt);
+        }
+    }
+
+    const GetX get_x_;
+    const GetY get_y_;
+
+    std::vector<T>      points_;
+    std::vector<Column> columns_;
+    Tree<Column>        tree_;
+};
+
+/// A collection of many small ordered sets of values sharing one node pool, for applications that keep a large
+/// number of tiny sets, such as an index per subscription.
+///
+/// Each set is a tree of a cavl::Forest represented by its root pointer alone, so an empty set costs one word
+/// instead of a whole cavl::Tree, and the sets are addressed by dense 32-bit handles. The nodes of all sets are
+/// allocated from large chunks of a shared pool, which eliminates the per-node overhead of the heap allocator;
+/// the freed nodes are reused by any set. All sets can be emptied at once in time proportional to the number of
+/// sets (or of the values if T is not trivially destructible), and the pool memory is retained for reuse.
+///
+/// The container is not thread-safe.
+template <typename T, typename Compare = std::less<T>>
+class PooledForest final
+{
+public:
+    using Handle = std::uint32_t;
+
+    struct Stats final
+    {
+        std::size_t size   = 0;
+        std::size_t height = 0;
+    };
+
+    /// The chunk size is the number of nodes allocated at once when the pool is exhausted.
+    explicit PooledForest(const std::size_t chunk_size = 1024, const Compare& compare = Compare{}) :
+        chunk_size_(chunk_size), compare_(compare)
+    {
+        CAVL_ASSERT(chunk_size > 0U);
+    }
+
+    ~PooledForest() { clear(); }
+
+    PooledForest(const PooledForest&)                    = delete;
+    PooledForest(PooledForest&&)                         = delete;
+    auto operator=(const PooledForest&) -> PooledForest& = delete;
+    auto operator=(PooledForest&&) -> PooledForest&      = delete;
+
+    /// Creates a new empty set. The handles are issued sequentially starting from zero and remain valid
+    /// for the lifetime of the container.
+    auto create() -> Handle
+    {
+        CAVL_ASSERT(roots_.size() < std::numeric_limits<Handle>::max());
+        roots_.push_back(nullptr);
+        return static_cast<Handle>(roots_.size() - 1U);
+    }
+    void reserve(const std::size_t set_count) { roots_.reserve(set_count); }
+
+    /// Returns false if an equivalent value is already present, in which case the set is not modified.
+    auto insert(const Handle set, T value) -> bool
+    {
+        const auto res = forest_.search(
+            getRoot(set),
+            [&](const Entry& x) { return compare_(value, x.value); },
+            [&] {
+                void* const slot = allocate();
+                try
+                {
+                    return new (slot) Entry(std::move(value));
+                }
+                catch (...)
+                {
+                    recycle(slot);  // The forest is not modified if the factory throws.
+                    throw;
+                }
+            });
+        if (!std::get<1>(res))
+        {
+            size_++;
+        }
+        return !std::get<1>(res);
+    }
+
+    /// Returns true if the value was found and removed.
+    auto remove(const Handle set, const T& key) -> bool
+    {
+        Entry*&      root  = getRoot(set);
+        Entry* const entry = Forest<Entry>::search(root, [&](const Entry& x) { return compare_(key, x.value); });
+        if (entry == nullptr)
+        {
+            return false;
+        }
+        forest_.remove(root, entry);
+        release(*entry);
+        size_--;
+        return true;
+    }
+
+    /// If the value is found, the visitor is invoked with a const reference to it and true is returned.
+    template <typename Vis>
+    auto find(const Handle set, const T& key, const Vis& visitor) const -> bool
+    {
+        const Entry* const root  = getRoot(set);
+        const Entry* const entry = Forest<Entry>::search(root, [&](const Entry& x) { return compare_(key, x.value); });
+        if (entry != nullptr)
+        {
+            visitor(entry->value);
+            return true;
+        }
+        return false;
+    }
+    auto contains(const Handle set, const T& key) const -> bool
+    {
+        return find(set, key, [](const T& /*unused*/) {});
+    }
+
+    /// Visits all values of the set in order. The visitor shall not modify the container.
+    template <typename Vis>
+    void traverse(const Handle set, const Vis& visitor) const
+    {
+        const Entry* const root = getRoot(set);
+        Forest<Entry>::traverseInOrder(root, [&visitor](const Entry& x) { visitor(x.value); });
+    }
+
+    /// Removes all values from the set; the handle remains valid.
+    void clear(const Handle set)
+    {
+        (void) forest_.reclaim(getRoot(set), [this](Entry& x) {
+            release(x);
+            size_--;
+        });
+    }
+
+    /// Removes all values from all sets; the handles remain valid.
+    void clear()
+    {
+        if constexpr (std::is_trivially_destructible<T>::value)
+        {
+            std::fill(roots_.begin(), roots_.end(), nullptr);  // The whole pool is reclaimed below.
+            size_ = 0;
+        }
+        else
+        {
+            for (std::size_t i = 0; i < roots_.size(); i++)
+            {
+                clear(static_cast<Handle>(i));
+            }
+        }
+        free_ = nullptr;
+        used_ = 0;
+    }
+
+    /// The size is computed in linear time and the height in logarithmic time.
+    auto getStats(const Handle set) const -> Stats
+    {
+        const Entry* const root = getRoot(set);
+        Stats              out{};
+        Forest<Entry>::traverseInOrder(root, [&out](const Entry& /*unused*/) { out.size++; });
+        out.height = Forest<Entry>::getHeight(root);
+        return out;
+    }
+
+    auto getSetCount() const noexcept -> std::size_t { return roots_.size(); }
+
+    /// The total number of values in all sets.
+    auto size() const noexcept -> std::size_t { return size_; }
+
+    /// The number of bytes allocated by the container, including the unused part of the pool.
+    auto getMemoryUsage() const noexcept -> std::size_t
+    {
+        return sizeof(*this) + (chunks_.capacity() * sizeof(chunks_.front())) +
+               (chunks_.size() * chunk_size_ * sizeof(Slot)) + (roots_.capacity() * sizeof(Entry*));
+    }
+
+private:
+    class Entry final : public Node<Entry>
+    {
+    public:
+        explicit Entry(T&& val) : value(std::move(val)) {}
+
+        T value;
+    };
+
+    /// A free slot links to the next free slot; the first unused slot of the last chunk is tracked separately.
+    union Slot  // NOLINT(*-type-union-access)
+    {
+        Slot*         next;
+        alignas(Entry) unsigned char bytes[sizeof(Entry)];  // NOLINT(*-avoid-c-arrays)
+    };
+
+    auto getRoot(const Handle set) -> Entry*&
+    {
+        CAVL_ASSERT(set < roots_.size());
+        return roots_[set];
+    }
+    auto getRoot(const Handle set) const -> const Entry*
+    {
+        CAVL_ASSERT(set < roots_.size());
+        return roots_[set];
+    }
+
+    auto allocate() -> void*
+    {
+        if (free_ != nullptr)
+        {
+            Slot* const out = free_;
+            free_           = out->next;  // NOLINT(*-union-access)
+            return out;
+        }
+        if (used_ == (chunks_.size() * chunk_size_))
+        {
+            chunks_.emplace_back(new Slot[chunk_size_]);  // NOLINT(*-owning-memory)
+        }
+        Slot* const out = &chunks_[used_ / chunk_size_][used_ % chunk_size_];
+        used_++;
+        return out;
+    }
+
+    void release(Entry& entry)
+    {
+        entry.~Entry();
+        recycle(&entry);
+    }
+
+    /// Returns the slot to the pool; the entry in it, if any, shall have been destroyed.
+    void recycle(void* const memory) noexcept
+    {
+        Slot* const slot = static_cast<Slot*>(memory);
+        slot->next       = free_;  // NOLINT(*-union-access)
+        free_            = slot;
+    }
+
+    const std::size_t               chunk_size_;
+    const detail::ThreeWay<Compare> compare_;
+
+    Forest<Entry>                        forest_;
+    std::vector<Entry*>                  roots_;
+    std::vector<std::unique_ptr<Slot[]>> chunks_;  // NOLINT(*-avoid-c-arrays)
+    Slot*                                free_ = nullptr;
+    std::size_t                          used_ = 0;  ///< The number of slots ever taken from the chunks.
+    std::size_t                          size_ = 0;
+};
+
+}  // namespace cavl
+
+// NOLINTEND(cppcoreguidelines-pro-bounds-constant-array-index)
@@ -15,6 +15,7 @@
 #include <limits>
 #include <memory>
 #include <numeric>
+#include <set>
 #include <sstream>
 #include <string>
 #include <type_traits>
@@ -964,6 +965,485 @@ void testRandomized()
     validate();
 }
 
+void testReclaim()
+{
+    MyTree tr;
+    for (std::uint16_t i = 0U; i < 1000U; i++)
+    {
+        const auto x = static_cast<std::uint16_t>(getRandomByte() * 256U + getRandomByte());
+        (void) tr.search([x](const My& v) { return x - v.getValue(); }, [x] { return new My(x); });  // NOLINT
+    }
+    std::vector<std::uint16_t> expected;
+    tr.traversePostOrder([&](const My& x) { expected.push_back(x.getValue()); });
+    const auto size = tr.size();
+    TEST_ASSERT_EQUAL(expected.size(), size);
+
+    // Detach the whole tree in constant time; the original tree is empty and reusable afterward.
+    MyTree orphan{std::move(tr)};
+    TEST_ASSERT_TRUE(tr.empty());
+    TEST_ASSERT_EQUAL(size, orphan.size());
+
+    std::vector<std::uint16_t> order;
+    const auto                 reclaimer = [&](My& x) {
+        TEST_ASSERT_FALSE(x.isLinked());
+        TEST_ASSERT_NULL(x.getChildNode(false));
+        TEST_ASSERT_NULL(x.getChildNode(true));
+        order.push_back(x.getValue());
+        delete &x;  // NOLINT(*-owning-memory)
+    };
+    TEST_ASSERT_FALSE(orphan.reclaim(reclaimer, 0));
+    TEST_ASSERT_EQUAL(0, order.size());
+    std::size_t steps = 0;
+    while (!orphan.reclaim(reclaimer, 37))
+    {
+        steps++;
+        TEST_ASSERT_EQUAL(steps * 37U, order.size());
+        TEST_ASSERT_NULL(findBrokenAncestry<My>(orphan));  // The remainder is still a well-formed ordered tree.
+        TEST_ASSERT_EQUAL(size - order.size(), checkOrdering<My>(orphan));
+    }
+    TEST_ASSERT_TRUE(orphan.empty());
+    TEST_ASSERT_EQUAL(expected.size(), order.size());
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(expected.data(), order.data(), order.size());
+    TEST_ASSERT_TRUE(orphan.reclaim(reclaimer));  // Reclaiming an empty tree is a no-op.
+    TEST_ASSERT_EQUAL(expected.size(), order.size());
+}
+
+void testSearchSorted()
+{
+    MyTree                     tr;
+    std::vector<std::uint16_t> present;
+    for (std::uint16_t i = 0U; i < 1000U; i++)
+    {
+        const auto x = static_cast<std::uint16_t>(i * 3U);
+        (void) tr.search([x](const My& v) { return x - v.getValue(); }, [x] { return new My(x); });  // NOLINT
+        present.push_back(x);
+    }
+    std::size_t calls     = 0;
+    const auto  predicate = [&calls](const std::uint16_t key, const My& v) {
+        calls++;
+        return key - v.getValue();
+    };
+    const auto check = [&](const std::vector<std::uint16_t>& keys) {
+        std::vector<My*> out(keys.size(), reinterpret_cast<My*>(&calls));  // NOLINT poison the output
+        tr.searchSorted(keys.data(), keys.size(), predicate, out.data());
+        for (std::size_t i = 0; i < keys.size(); i++)
+        {
+            My* const expected = tr.search([&](const My& v) { return keys.at(i) - v.getValue(); });
+            TEST_ASSERT_EQUAL(expected, out.at(i));
+        }
+        std::vector<const My*> const_out(keys.size(), nullptr);
+        static_cast<const MyTree&>(tr).searchSorted(keys.data(), keys.size(), predicate, const_out.data());
+        TEST_ASSERT_TRUE(std::equal(out.begin(), out.end(), const_out.begin()));
+    };
+
+    // Dense batch: every key is present and adjacent, so the amortized cost is constant per key.
+    calls = 0;
+    tr.searchSorted(present.data(), present.size(), predicate, std::vector<My*>(present.size()).data());
+    std::cout << "Dense batch of " << present.size() << " keys: " << calls << " predicate calls" << std::endl;
+    TEST_ASSERT_LESS_THAN(present.size() * 4U, calls);
+    check(present);
+
+    // Random batches with duplicates and missing keys.
+    for (std::size_t iter = 0; iter < 100U; iter++)
+    {
+        std::vector<std::uint16_t> keys(getRandomByte());
+        for (auto& k : keys)
+        {
+            k = static_cast<std::uint16_t>((getRandomByte() * 13U) + (getRandomByte() % 8U));
+        }
+        std::sort(keys.begin(), keys.end());
+        check(keys);
+    }
+    check({});
+
+    // Empty tree.
+    MyTree              empty;
+    const std::uint16_t key = 1;
+    std::array<My*, 1>  out{{reinterpret_cast<My*>(&calls)}};  // NOLINT
+    empty.searchSorted(&key, 1, predicate, out.data());
+    TEST_ASSERT_NULL(out.at(0));
+    tr.reclaim([](My& x) { delete &x; });  // NOLINT(*-owning-memory)
+}
+
+void testTraverseInOrderBatched()
+{
+    MyTree tr;
+    for (std::size_t i = 0U; i < 1000U; i++)
+    {
+        const auto x = static_cast<std::uint16_t>((getRandomByte() * 256U) + getRandomByte());
+        (void) tr.search([x](const My& v) { return x - v.getValue(); }, [x] { return new My(x); });  // NOLINT
+    }
+    for (const bool reverse : {false, true})
+    {
+        std::vector<const My*> expected;
+        tr.traverseInOrder([&](const My& x) { expected.push_back(&x); }, reverse);
+        std::vector<const My*> actual;
+        std::size_t            batches = 0;
+        tr.traverseInOrderBatched<7>(
+            [&](My* const* const nodes, const std::size_t count) {
+                TEST_ASSERT_TRUE((count > 0U) && (count <= 7U));
+                actual.insert(actual.end(), nodes, nodes + count);  // NOLINT(*-pointer-arithmetic)
+                batches++;
+            },
+            reverse);
+        TEST_ASSERT_TRUE(expected == actual);
+        TEST_ASSERT_EQUAL((expected.size() + 6U) / 7U, batches);
+
+        // The returning visitor stops at the first true value; the batches are full except the last one.
+        actual.clear();
+        const auto found = static_cast<const MyTree&>(tr).traverseInOrderBatched(
+            [&](const My* const* const nodes, const std::size_t count) -> const My* {
+                TEST_ASSERT_EQUAL(64, count);
+                actual.insert(actual.end(), nodes, nodes + count);  // NOLINT(*-pointer-arithmetic)
+                return (actual.size() >= 200U) ? actual.back() : nullptr;
+            },
+            reverse);
+        TEST_ASSERT_EQUAL(256, actual.size());
+        TEST_ASSERT_TRUE(std::equal(actual.begin(), actual.end(), expected.begin()));
+        TEST_ASSERT_EQUAL(expected.at(255), found);
+
+        // The final partial batch may also stop the traversal.
+        TEST_ASSERT_EQUAL(expected.back(),
+                          tr.traverseInOrderBatched<1000>(
+                              [](My* const* const nodes, const std::size_t count) {
+                                  return nodes[count - 1U];  // NOLINT(*-pointer-arithmetic)
+                              },
+                              reverse));
+    }
+    MyTree empty;
+    TEST_ASSERT_NULL(empty.traverseInOrderBatched([](My* const* const nodes, const std::size_t) { return *nodes; }));
+    tr.reclaim([](My& x) { delete &x; });  // NOLINT(*-owning-memory)
+}
+
+void testCursor()
+{
+    MyTree                  tr;
+    std::set<std::uint16_t> reference;
+    const auto              insert = [&](const std::uint16_t x) {
+        (void) tr.search([x](const My& v) { return x - v.getValue(); }, [x] { return new My(x); });  // NOLINT
+        reference.insert(x);
+    };
+    for (std::size_t i = 0U; i < 500U; i++)
+    {
+        insert(static_cast<std::uint16_t>(getRandomByte() * 4U));
+    }
+    for (const bool reverse : {false, true})
+    {
+        // Erase every other node and insert new nodes on both sides of the cursor while iterating.
+        // The nodes inserted ahead of the cursor are visited; those inserted behind it are not.
+        std::vector<std::uint16_t> visited;
+        std::size_t                index = 0;
+        for (auto cur = tr.getCursor(reverse); cur; index++)
+        {
+            const std::uint16_t x = cur.get()->getValue();
+            visited.push_back(x);
+            if ((x % 4U) == 0U)
+            {
+                insert(static_cast<std::uint16_t>(x + 1U));
+                insert(static_cast<std::uint16_t>(x + 2U));
+                insert(static_cast<std::uint16_t>(x - 1U));
+            }
+            if ((index % 2U) == 0U)
+            {
+                My* const removed = cur.erase();
+                TEST_ASSERT_EQUAL(x, removed->getValue());
+                TEST_ASSERT_FALSE(removed->isLinked());
+                reference.erase(x);
+                delete removed;  // NOLINT(*-owning-memory)
+            }
+            else
+            {
+                cur.next();
+            }
+            if (cur)
+            {
+                TEST_ASSERT_TRUE(reverse ? (cur.get()->getValue() < x) : (cur.get()->getValue() > x));
+            }
+        }
+        TEST_ASSERT_TRUE(std::is_sorted(visited.begin(), visited.end(), [reverse](auto a, auto b) {
+            return reverse ? (a > b) : (a < b);
+        }));
+        std::vector<std::uint16_t> actual;
+        tr.traverseInOrder([&](const My& x) { actual.push_back(x.getValue()); });
+        TEST_ASSERT_TRUE(std::equal(actual.begin(), actual.end(), reference.begin(), reference.end()));
+        TEST_ASSERT_NULL(findBrokenBalanceFactor<My>(tr));
+    }
+
+    // Purge the whole tree starting from a given node.
+    auto* const mid   = tr[tr.size() / 2U];
+    const auto  bound = mid->getValue();  // The node is destroyed first, so keep a copy of its value.
+    for (auto cur = tr.getCursor(mid); cur;)
+    {
+        delete cur.erase();  // NOLINT(*-owning-memory)
+    }
+    tr.traverseInOrder([&](const My& x) { TEST_ASSERT_TRUE(x.getValue() < bound); });
+    for (auto cur = tr.getCursor(true); cur;)
+    {
+        delete cur.erase();  // NOLINT(*-owning-memory)
+    }
+    TEST_ASSERT_TRUE(tr.empty());
+}
+
+void testEncodeLevelOrder()
+{
+    MyTree                  tr;
+    std::set<std::uint16_t> reference;
+    for (std::size_t i = 0U; i <= 300U; i++)
+    {
+        // The encoding is independent of the shape of the tree, so every size shall produce a valid search tree.
+        std::vector<std::uint16_t> table(reference.size(), 0);
+        std::vector<bool>          written(reference.size(), false);
+        std::vector<std::uint16_t> emitted;
+        const auto                 count = tr.encodeLevelOrder([&](const std::size_t index, const My& node) {
+            TEST_ASSERT_TRUE(index < table.size());
+            TEST_ASSERT_FALSE(written.at(index));
+            written.at(index) = true;
+            table.at(index)   = node.getValue();
+            emitted.push_back(node.getValue());
+        });
+        TEST_ASSERT_EQUAL(reference.size(), count);
+        TEST_ASSERT_TRUE(std::equal(emitted.begin(), emitted.end(), reference.begin(), reference.end()));
+        for (std::uint32_t key = 0U; key < 1024U; key++)
+        {
+            std::size_t index = 0;
+            while ((index < table.size()) && (table.at(index) != key))
+            {
+                index = (2U * index) + ((key > table.at(index)) ? 2U : 1U);
+            }
+            TEST_ASSERT_EQUAL(reference.count(static_cast<std::uint16_t>(key)) > 0U, index < table.size());
+        }
+        const auto x = static_cast<std::uint16_t>(getRandomByte() * 4U);
+        (void) tr.search([x](const My& v) { return x - v.getValue(); }, [x] { return new My(x); });  // NOLINT
+        reference.insert(x);
+    }
+    tr.reclaim([](My& x) { delete &x; });  // NOLINT(*-owning-memory)
+}
+
+/// Unlike My, the value can be modified in place, which is needed to test repositioning.
+class Mutable : public cavl::Node<Mutable>
+{
+public:
+    explicit Mutable(const std::uint16_t v) : value(v) {}
+    using Self = cavl::Node<Mutable>;
+    using Self::isLinked;
+    using Self::getChildNode;
+    using Self::getParentNode;
+    using Self::getBalanceFactor;
+    using Self::traverseInOrder;
+
+    NODISCARD auto getValue() const -> std::uint16_t { return value; }
+    void           setValue(const std::uint16_t v) { value = v; }
+
+private:
+    std::uint16_t value;
+};
+
+void testSearchPath()
+{
+    using MutableTree = cavl::Tree<Mutable>;
+    MutableTree             tr;
+    MutableTree::Path       path;
+    std::set<std::uint16_t> reference;
+    const auto pred  = [](const std::uint16_t x) { return [x](const Mutable& v) { return x - v.getValue(); }; };
+    const auto check = [&] {
+        const Mutable* const root = tr;
+        TEST_ASSERT_EQUAL(reference.size(), checkOrdering<Mutable>(root));
+        TEST_ASSERT_NULL(findBrokenAncestry<Mutable>(root));
+        TEST_ASSERT_NULL(findBrokenBalanceFactor<Mutable>(root));
+    };
+    TEST_ASSERT_NULL(tr.searchPath(pred(1), path));
+    TEST_ASSERT_EQUAL(0, path.size());
+    TEST_ASSERT_NULL(path.back());
+    TEST_ASSERT_FALSE(path.isFound());
+    for (std::uint32_t i = 0U; i < 20'000U; i++)
+    {
+        const auto     x    = static_cast<std::uint16_t>(getRandomByte());
+        Mutable* const node = tr.searchPath(pred(x), path);
+        TEST_ASSERT_EQUAL(reference.count(x) > 0U, node != nullptr);
+        TEST_ASSERT_EQUAL(node != nullptr, path.isFound());
+        TEST_ASSERT_TRUE(path.size() <= Mutable::MaxHeight);
+        if (node != nullptr)
+        {
+            TEST_ASSERT_EQUAL(node, path.back());
+        }
+        switch (getRandomByte() % 3U)
+        {
+        case 0:
+            if (node == nullptr)
+            {
+                tr.insertAt(path, new Mutable(x));  // NOLINT(*-owning-memory)
+                reference.insert(x);
+                TEST_ASSERT_EQUAL(0, path.size());
+            }
+            break;
+        case 1:
+            if (node != nullptr)
+            {
+                tr.removeAt(path);
+                TEST_ASSERT_FALSE(node->isLinked());
+                delete node;  // NOLINT(*-owning-memory)
+                reference.erase(x);
+            }
+            break;
+        default:
+            if (node != nullptr)
+            {
+                // Small changes often keep the node in place, large ones move it elsewhere.
+                const auto y = static_cast<std::uint16_t>(((getRandomByte() % 2U) == 0U) ? (x ^ 1U) : getRandomByte());
+                node->setValue(y);
+                reference.erase(x);
+                if (tr.reposition(path, pred(y)))
+                {
+                    TEST_ASSERT_TRUE(reference.insert(y).second);
+                    TEST_ASSERT_EQUAL(node, tr.search(pred(y)));
+                }
+                else
+                {
+                    TEST_ASSERT_TRUE(reference.count(y) > 0U);
+                    TEST_ASSERT_FALSE(node->isLinked());
+                    delete node;  // NOLINT(*-owning-memory)
+                }
+            }
+            break;
+        }
+        if ((i % 32U) == 0U)
+        {
+            check();
+        }
+    }
+    check();
+    tr.reclaim([](Mutable& x) { delete &x; });  // NOLINT(*-owning-memory)
+}
+
+void testSplayTree()
+{
+    using MySplayTree = cavl::SplayTree<My>;
+    MySplayTree             tr;
+    std::set<std::uint16_t> reference;
+    const auto              pred = [](const std::uint16_t x) { return [x](const My& v) { return x - v.getValue(); }; };
+    const auto              check = [&] {
+        const My* const root = tr;
+        TEST_ASSERT_EQUAL(reference.size(), checkOrdering<My>(root));
+        TEST_ASSERT_NULL(findBrokenAncestry<My>(root));
+        TEST_ASSERT_EQUAL(reference.size(), tr.size());
+        TEST_ASSERT_EQUAL(reference.empty(), tr.empty());
+        // The AVL balance is not maintained, so the balance factors shall remain untouched.
+        tr.traverseInOrder([](const My& x) { TEST_ASSERT_EQUAL(0, x.getBalanceFactor()); });
+    };
+    TEST_ASSERT_NULL(tr.search(pred(1)));
+    for (std::uint32_t i = 0U; i < 10'000U; i++)
+    {
+        const auto x = static_cast<std::uint16_t>(getRandomByte());
+        switch (getRandomByte() % 3U)
+        {
+        case 0:
+        {
+            const auto res = tr.search(pred(x), [x] { return new My(x); });  // NOLINT(*-owning-memory)
+            TEST_ASSERT_EQUAL(!reference.insert(x).second, std::get<1>(res));
+            TEST_ASSERT_EQUAL(std::get<0>(res), static_cast<My*>(tr));  // The accessed node becomes the root.
+            TEST_ASSERT_EQUAL(x, std::get<0>(res)->getValue());
+            break;
+        }
+        case 1:
+        {
+            My* const node = tr.search(pred(x));
+            TEST_ASSERT_EQUAL(reference.erase(x) > 0U, node != nullptr);
+            tr.remove(node);
+            tr.remove(node);  // No effect on an unlinked node.
+            delete node;      // NOLINT(*-owning-memory)
+            break;
+        }
+        default:
+        {
+            My* const node = tr.search(pred(x));
+            TEST_ASSERT_EQUAL(reference.count(x) > 0U, node != nullptr);
+            if (node != nullptr)
+            {
+                TEST_ASSERT_EQUAL(node, static_cast<My*>(tr));
+            }
+            break;
+        }
+        }
+        if ((i % 64U) == 0U)
+        {
+            check();
+        }
+    }
+    check();
+    // A failed insertion leaves the tree intact.
+    TEST_ASSERT_TRUE(std::make_tuple(nullptr, true) == tr.search(pred(1000), []() -> My* { return nullptr; }));
+    check();
+    // Sequential access turns the tree into a chain and back; the ordering shall survive.
+    if (!reference.empty())
+    {
+        TEST_ASSERT_EQUAL(*reference.begin(), tr.min()->getValue());
+        TEST_ASSERT_EQUAL(*reference.rbegin(), tr.max()->getValue());
+    }
+    for (const auto x : reference)
+    {
+        TEST_ASSERT_NOT_NULL(tr.search(pred(x)));
+    }
+    check();
+    MySplayTree moved(std::move(tr));
+    TEST_ASSERT_TRUE(tr.empty());  // NOLINT(*-use-after-move)
+    TEST_ASSERT_EQUAL(reference.size(), moved.size());
+    TEST_ASSERT_TRUE(moved.reclaim([](My& x) { delete &x; }));  // NOLINT(*-owning-memory)
+    TEST_ASSERT_TRUE(moved.empty());
+}
+
+void testForest()
+{
+    constexpr std::size_t                          TreeCount = 8;
+    cavl::Forest<My>                               forest;
+    std::array<My*, TreeCount>                     roots{};
+    std::array<std::set<std::uint16_t>, TreeCount> references{};
+    const auto pred = [](const std::uint16_t x) { return [x](const My& v) { return x - v.getValue(); }; };
+    for (std::uint32_t i = 0U; i < 20'000U; i++)
+    {
+        const std::size_t t    = getRandomByte() % TreeCount;
+        const auto        x    = static_cast<std::uint16_t>(getRandomByte());
+        My*&              root = roots.at(t);
+        if ((getRandomByte() % 2U) == 0U)
+        {
+            const auto res = forest.search(root, pred(x), [x] { return new My(x); });  // NOLINT(*-owning-memory)
+            TEST_ASSERT_EQUAL(!references.at(t).insert(x).second, std::get<1>(res));
+        }
+        else
+        {
+            My* const node = cavl::Forest<My>::search(root, pred(x));
+            TEST_ASSERT_EQUAL(references.at(t).erase(x) > 0U, node != nullptr);
+            forest.remove(root, node);
+            forest.remove(root, node);  // No effect on an unlinked node.
+            delete node;                // NOLINT(*-owning-memory)
+        }
+        if ((i % 64U) == 0U)
+        {
+            // The trees are independent: each one is a valid AVL tree of its own values.
+            for (std::size_t k = 0; k < TreeCount; k++)
+            {
+                const My* const rt = roots.at(k);
+                TEST_ASSERT_EQUAL(references.at(k).size(), checkOrdering<My>(rt));
+                TEST_ASSERT_NULL(findBrokenAncestry<My>(rt));
+                TEST_ASSERT_NULL(findBrokenBalanceFactor<My>(rt));
+                TEST_ASSERT_EQUAL(getHeight<My>(rt), cavl::Forest<My>::getHeight(rt));
+                TEST_ASSERT_TRUE((rt == nullptr) || rt->isRoot());
+            }
+        }
+    }
+    std::size_t visited = 0;
+    cavl::Forest<My>::traverseInOrder(roots.at(0), [&](const My& /*unused*/) { visited++; });
+    TEST_ASSERT_EQUAL(references.at(0).size(), visited);
+    for (auto& root : roots)
+    {
+        // Reclaim in small steps to ensure that the root is kept up to date between the calls.
+        while (!forest.reclaim(root, [](My& x) { delete &x; }, 3))  // NOLINT(*-owning-memory)
+        {
+            TEST_ASSERT_NOT_NULL(root);
+        }
+        TEST_ASSERT_NULL(root);
+    }
+}
+
 void testManualMy()
 {
     static_assert(!std::is_copy_assignable<My>::value, "Should not be copy assignable.");
@@ -1115,6 +1595,14 @@ int main(const int argc, const char* const argv[])
     RUN_TEST(testManualMy);
     RUN_TEST(testManualV);
     RUN_TEST(testRandomized);
+    RUN_TEST(testReclaim);
+    RUN_TEST(testSearchSorted);
+    RUN_TEST(testTraverseInOrderBatched);
+    RUN_TEST(testCursor);
+    RUN_TEST(testEncodeLevelOrder);
+    RUN_TEST(testSearchPath);
+    RUN_TEST(testSplayTree);
+    RUN_TEST(testForest);
     return UNITY_END();
     // NOLINTEND(misc-include-cleaner)
 }
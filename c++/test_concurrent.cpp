@@ -0,0 +1,910 @@
+/// Copyright (c) 2021 Pavel Kirienko <pavel@uavcan.org>
+
+#include "cavl_concurrent.hpp"
+
+#include <unity.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <future>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+void setUp() {}
+
+void tearDown() {}
+
+namespace
+{
+auto getRandomByte()
+{
+    return static_cast<std::uint8_t>((0xFFLL * std::rand()) / RAND_MAX);
+}
+
+auto matching(const int key)
+{
+    return [key](const int x) { return key - x; };
+}
+
+void testReplicatedBasic()
+{
+    cavl::Replicated<int> set(3);
+    TEST_ASSERT_EQUAL(3, set.getReplicaCount());
+    TEST_ASSERT_EQUAL(0, set.size());
+    TEST_ASSERT_FALSE(set.contains(0, matching(1)));
+
+    TEST_ASSERT_TRUE(set.insert(5));
+    TEST_ASSERT_TRUE(set.insert(1));
+    TEST_ASSERT_TRUE(set.insert(9));
+    TEST_ASSERT_FALSE(set.insert(5));
+    TEST_ASSERT_EQUAL(3, set.size());
+    for (std::size_t r = 0; r < set.getReplicaCount(); r++)
+    {
+        for (const int x : {1, 5, 9})
+        {
+            int seen = 0;
+            TEST_ASSERT_TRUE(set.read(r, matching(x), [&](const int v) { seen = v; }));
+            TEST_ASSERT_EQUAL(x, seen);
+        }
+        TEST_ASSERT_FALSE(set.contains(r, matching(4)));
+    }
+
+    TEST_ASSERT_TRUE(set.remove(matching(5)));
+    TEST_ASSERT_FALSE(set.remove(matching(5)));
+    TEST_ASSERT_EQUAL(2, set.size());
+    for (std::size_t r = 0; r < set.getReplicaCount(); r++)
+    {
+        TEST_ASSERT_FALSE(set.contains(r, matching(5)));
+        TEST_ASSERT_TRUE(set.contains(r, matching(1)));
+        TEST_ASSERT_TRUE(set.contains(r, matching(9)));
+    }
+    set.synchronize();
+    TEST_ASSERT_EQUAL(2, set.size());
+}
+
+void testReplicatedLogWraparound()
+{
+    // The log is much smaller than the number of operations, and replica 1 is never read until the end,
+    // so the writer has to bring it up to date by itself many times.
+    cavl::Replicated<int> set(2, 4);
+    std::set<int>         reference;
+    for (std::uint32_t i = 0; i < 10'000U; i++)
+    {
+        const int x = getRandomByte();
+        if ((getRandomByte() % 2U) != 0)
+        {
+            TEST_ASSERT_EQUAL(reference.insert(x).second, set.insert(x));
+        }
+        else
+        {
+            TEST_ASSERT_EQUAL(reference.erase(x) > 0U, set.remove(matching(x)));
+        }
+        TEST_ASSERT_EQUAL(reference.count(x) > 0U, set.contains(0, matching(x)));
+    }
+    TEST_ASSERT_EQUAL(reference.size(), set.size());
+    for (int x = 0; x < 256; x++)
+    {
+        TEST_ASSERT_EQUAL(reference.count(x) > 0U, set.contains(1, matching(x)));
+    }
+}
+
+void testReplicatedThreaded()
+{
+    constexpr std::size_t Readers = 4;
+    cavl::Replicated<int> set(Readers, 64);
+    for (int x = 0; x < 256; x += 2)
+    {
+        TEST_ASSERT_TRUE(set.insert(x));
+    }
+    // Even keys are never removed, so every reader shall always find them regardless of the ongoing mutations.
+    std::atomic<bool>          stop{false};
+    std::atomic<std::uint64_t> failures{0};
+    std::vector<std::thread>   readers;
+    for (std::size_t r = 0; r < Readers; r++)
+    {
+        readers.emplace_back([&, r] {
+            std::uint64_t lookups = 0;
+            while (!stop.load() || (lookups < 1000U))
+            {
+                const int x = static_cast<int>((lookups * 2U) % 256U);
+                if (!set.contains(r, matching(x)))
+                {
+                    failures++;
+                }
+                (void) set.contains(r, matching(x + 1));
+                lookups++;
+            }
+        });
+    }
+    std::set<int> reference;
+    for (std::uint32_t i = 0; i < 20'000U; i++)
+    {
+        const int x = (getRandomByte() | 1);
+        if ((getRandomByte() % 2U) != 0)
+        {
+            TEST_ASSERT_EQUAL(reference.insert(x).second, set.insert(x));
+        }
+        else
+        {
+            TEST_ASSERT_EQUAL(reference.erase(x) > 0U, set.remove(matching(x)));
+        }
+    }
+    stop = true;
+    for (auto& t : readers)
+    {
+        t.join();
+    }
+    TEST_ASSERT_EQUAL(0, failures.load());
+    set.synchronize();
+    TEST_ASSERT_EQUAL(reference.size() + 128U, set.size());
+    for (std::size_t r = 0; r < Readers; r++)
+    {
+        for (int x = 1; x < 256; x += 2)
+        {
+            TEST_ASSERT_EQUAL(reference.count(x) > 0U, set.contains(r, matching(x)));
+        }
+    }
+}
+
+void testFlatCombinedBasic()
+{
+    cavl::FlatCombined<int> set(2);
+    TEST_ASSERT_EQUAL(2, set.getSlotCount());
+    TEST_ASSERT_EQUAL(0, set.size());
+    TEST_ASSERT_FALSE(set.contains(0, 5));
+    TEST_ASSERT_TRUE(set.insert(0, 5));
+    TEST_ASSERT_TRUE(set.insert(1, 3));
+    TEST_ASSERT_FALSE(set.insert(1, 5));
+    TEST_ASSERT_EQUAL(2, set.size());
+    TEST_ASSERT_TRUE(set.contains(1, 5));
+    TEST_ASSERT_TRUE(set.contains(0, 3));
+    TEST_ASSERT_FALSE(set.contains(0, 4));
+    TEST_ASSERT_TRUE(set.remove(0, 5));
+    TEST_ASSERT_FALSE(set.remove(1, 5));
+    TEST_ASSERT_FALSE(set.contains(1, 5));
+    TEST_ASSERT_EQUAL(1, set.size());
+}
+
+/// Throws when comparing the unlucky value to make the operations involving it fail.
+struct ThrowingLess final
+{
+    auto operator()(const int a, const int b) const -> bool
+    {
+        if ((a == 13) || (b == 13))
+        {
+            throw std::runtime_error("unlucky");
+        }
+        return a < b;
+    }
+};
+
+void testFlatCombinedException()
+{
+    cavl::FlatCombined<int, ThrowingLess> set(2);
+    TEST_ASSERT_TRUE(set.insert(0, 5));
+    // The exception reaches the requesting thread, and the combiner role is released for the next operation.
+    for (std::size_t i = 0; i < 3U; i++)
+    {
+        bool thrown = false;
+        try
+        {
+            (void) set.insert(i % 2U, 13);
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        TEST_ASSERT_TRUE(thrown);
+        TEST_ASSERT_TRUE(set.contains((i + 1U) % 2U, 5));
+    }
+    TEST_ASSERT_TRUE(set.insert(1, 7));
+    TEST_ASSERT_EQUAL(2, set.size());
+}
+
+/// Sleeps when comparing the slow value to keep the combiner busy for long enough for the other threads to park.
+struct SlowLess final
+{
+    auto operator()(const int a, const int b) const -> bool
+    {
+        if ((a == 99) || (b == 99))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return a < b;
+    }
+};
+
+void testFlatCombinedParking()
+{
+    cavl::FlatCombined<int, SlowLess> set(3);
+    TEST_ASSERT_TRUE(set.insert(0, 5));
+    // The other threads exhaust the spin limit while the combiner is busy, park, and are woken up when it is done.
+    bool        slow_result  = false;
+    bool        other_result = false;
+    std::thread slow([&] { slow_result = set.insert(0, 99); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    std::thread other([&] { other_result = set.contains(2, 5); });
+    TEST_ASSERT_TRUE(set.insert(1, 7));
+    slow.join();
+    other.join();
+    TEST_ASSERT_TRUE(slow_result);
+    TEST_ASSERT_TRUE(other_result);
+    TEST_ASSERT_EQUAL(3, set.size());
+}
+
+void testFlatCombinedThreaded()
+{
+    constexpr std::size_t   Threads = 8;
+    cavl::FlatCombined<int> set(Threads);
+    // Each thread operates on its own key range, so the outcome of every operation is deterministic.
+    std::array<std::set<int>, Threads> references{};
+    std::atomic<std::uint64_t>         failures{0};
+    std::vector<std::thread>           threads;
+    for (std::size_t t = 0; t < Threads; t++)
+    {
+        const auto seed = static_cast<std::uint32_t>(std::rand());
+        threads.emplace_back([&, t, seed] {
+            std::uint32_t  state     = seed;
+            std::set<int>& reference = references.at(t);
+            for (std::uint32_t i = 0; i < 20'000U; i++)
+            {
+                state        = (state * 1103515245U) + 12345U;
+                const int x  = static_cast<int>((t * 1000U) + ((state >> 16U) % 64U));
+                bool      ok = false;
+                switch ((state >> 8U) % 3U)
+                {
+                case 0:
+                    ok = reference.insert(x).second == set.insert(t, x);
+                    break;
+                case 1:
+                    ok = (reference.erase(x) > 0U) == set.remove(t, x);
+                    break;
+                default:
+                    ok = (reference.count(x) > 0U) == set.contains(t, x);
+                    break;
+                }
+                if (!ok)
+                {
+                    failures++;
+                }
+            }
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    TEST_ASSERT_EQUAL(0, failures.load());
+    std::size_t total = 0;
+    for (std::size_t t = 0; t < Threads; t++)
+    {
+        total += references.at(t).size();
+        for (int x = 0; x < 64; x++)
+        {
+            const int key = static_cast<int>(t * 1000U) + x;
+            TEST_ASSERT_EQUAL(references.at(t).count(key) > 0U, set.contains(0, key));
+        }
+    }
+    TEST_ASSERT_EQUAL(total, set.size());
+}
+
+void testDelegatedBasic()
+{
+    cavl::Delegated<int> set(2, 4);
+    using Op = cavl::Delegated<int>::Op;
+    TEST_ASSERT_EQUAL(2, set.getClientCount());
+    TEST_ASSERT_FALSE(set.contains(0, 5));
+    TEST_ASSERT_TRUE(set.insert(0, 5));
+    TEST_ASSERT_TRUE(set.insert(1, 3));
+    TEST_ASSERT_FALSE(set.insert(1, 5));
+    TEST_ASSERT_EQUAL(2, set.size());
+    TEST_ASSERT_TRUE(set.submit(1, Op::Contains, 5).get());
+    TEST_ASSERT_FALSE(set.submit(0, Op::Contains, 4).get());
+    // The requests of one client on the same key take effect in the order of submission despite the sorting.
+    // There are more requests than the ring capacity, so the client has to wait for the owner to make room.
+    std::vector<std::future<bool>> results;
+    for (int i = 0; i < 10; i++)
+    {
+        results.push_back(set.submit(0, Op::Insert, 7));
+        results.push_back(set.submit(0, Op::Remove, 7));
+    }
+    for (auto& r : results)
+    {
+        TEST_ASSERT_TRUE(r.get());
+    }
+    std::atomic<int> completed{0};
+    set.submit(1, Op::Remove, 5, [&](const bool ok) { completed += ok ? 1 : 100; });
+    set.submit(1, Op::Remove, 5, [&](const bool ok) { completed += ok ? 100 : 1; });
+    TEST_ASSERT_FALSE(set.contains(1, 5));
+    TEST_ASSERT_EQUAL(2, completed.load());
+    TEST_ASSERT_EQUAL(1, set.size());
+}
+
+void testDelegatedParking()
+{
+    cavl::Delegated<int> set(2);
+    using Op = cavl::Delegated<int>::Op;
+    // The owner is held up by a slow callback, so the blocked client exhausts the spin limit and parks.
+    set.submit(0, Op::Insert, 5, [](const bool) { std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+    TEST_ASSERT_TRUE(set.insert(1, 7));
+    TEST_ASSERT_TRUE(set.contains(1, 5));
+    TEST_ASSERT_EQUAL(2, set.size());
+}
+
+void testDelegatedThreaded()
+{
+    constexpr std::size_t              Threads    = 8;
+    constexpr std::size_t              Operations = 20'000;
+    std::atomic<std::uint64_t>         completed{0};
+    std::atomic<std::uint64_t> failures{0};
+    std::array<std::set<int>, Threads> references{};
+    {
+        cavl::Delegated<int> set(Threads, 16);
+        using Op = cavl::Delegated<int>::Op;
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < Threads; t++)
+        {
+            const auto seed = static_cast<std::uint32_t>(std::rand());
+            threads.emplace_back([&, t, seed] {
+                // The requests are pipelined, so the results arrive in a different order than the submissions;
+                // each thread operates on its own key range, so the expected outcome is known in advance.
+                std::uint32_t  state     = seed;
+                std::set<int>& reference = references.at(t);
+                for (std::uint32_t i = 0; i < Operations; i++)
+                {
+                    state       = (state * 1103515245U) + 12345U;
+                    const int x = static_cast<int>((t * 1000U) + ((state >> 16U) % 64U));
+                    Op        op{};
+                    bool      expected = false;
+                    switch ((state >> 8U) % 3U)
+                    {
+                    case 0:
+                        op       = Op::Insert;
+                        expected = reference.insert(x).second;
+                        break;
+                    case 1:
+                        op       = Op::Remove;
+                        expected = reference.erase(x) > 0U;
+                        break;
+                    default:
+                        op       = Op::Contains;
+                        expected = reference.count(x) > 0U;
+                        break;
+                    }
+                    set.submit(t, op, x, [&, expected](const bool result) {
+                        completed++;
+                        if (result != expected)
+                        {
+                            failures++;
+                        }
+                    });
+                }
+            });
+        }
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+        std::size_t total = 0;
+        for (std::size_t t = 0; t < Threads; t++)
+        {
+            total += references.at(t).size();
+            for (int x = 0; x < 64; x++)
+            {
+                const int key = static_cast<int>(t * 1000U) + x;
+                TEST_ASSERT_EQUAL(references.at(t).count(key) > 0U, set.contains(t, key));
+            }
+        }
+        TEST_ASSERT_EQUAL(total, set.size());
+    }
+    TEST_ASSERT_EQUAL(Threads * Operations, completed.load());
+    TEST_ASSERT_EQUAL(0, failures.load());
+}
+
+void testLogStructuredBasic()
+{
+    cavl::LogStructured<int> set(4);
+    TEST_ASSERT_FALSE(set.contains(1));
+    set.insert(1);
+    set.insert(2);
+    set.insert(3);
+    TEST_ASSERT_TRUE(set.contains(2));
+    TEST_ASSERT_EQUAL(0, set.getFrozenSize());
+    set.flush();
+    TEST_ASSERT_EQUAL(3, set.getFrozenSize());
+    TEST_ASSERT_TRUE(set.contains(1));
+    TEST_ASSERT_TRUE(set.contains(2));
+    TEST_ASSERT_TRUE(set.contains(3));
+
+    // The tombstone in the write buffer shadows the value in the sorted array until the next merge.
+    set.remove(2);
+    set.remove(7);
+    TEST_ASSERT_FALSE(set.contains(2));
+    TEST_ASSERT_FALSE(set.contains(7));
+    TEST_ASSERT_EQUAL(3, set.getFrozenSize());
+    set.insert(2);
+    TEST_ASSERT_TRUE(set.contains(2));
+    set.remove(2);
+    set.remove(3);
+    std::vector<int> values;
+    set.traverse([&](const int x) { values.push_back(x); });
+    TEST_ASSERT_EQUAL(1, values.size());
+    TEST_ASSERT_EQUAL(1, values.at(0));
+    set.flush();
+    TEST_ASSERT_EQUAL(1, set.getFrozenSize());
+    TEST_ASSERT_TRUE(set.contains(1));
+    TEST_ASSERT_FALSE(set.contains(2));
+    TEST_ASSERT_FALSE(set.contains(3));
+}
+
+void testLogStructuredRandomized()
+{
+    cavl::LogStructured<int> set(16);
+    std::set<int>            reference;
+    for (std::uint32_t i = 0; i < 20'000U; i++)
+    {
+        const int x = getRandomByte();
+        if ((getRandomByte() % 2U) != 0)
+        {
+            set.insert(x);
+            reference.insert(x);
+        }
+        else
+        {
+            set.remove(x);
+            reference.erase(x);
+        }
+        TEST_ASSERT_EQUAL(reference.count(x) > 0U, set.contains(x));
+        if ((i % 1000U) == 0U)
+        {
+            std::vector<int> values;
+            set.traverse([&](const int v) { values.push_back(v); });
+            TEST_ASSERT_TRUE(std::equal(values.begin(), values.end(), reference.begin(), reference.end()));
+        }
+    }
+    set.flush();
+    TEST_ASSERT_EQUAL(reference.size(), set.getFrozenSize());
+    for (int x = 0; x < 256; x++)
+    {
+        TEST_ASSERT_EQUAL(reference.count(x) > 0U, set.contains(x));
+    }
+}
+
+void testLogStructuredThreaded()
+{
+    cavl::LogStructured<int> set(8);
+    for (int x = 0; x < 256; x += 2)
+    {
+        set.insert(x);
+    }
+    std::atomic<bool>          stop{false};
+    std::atomic<std::uint64_t> failures{0};
+    std::vector<std::thread>   readers;
+    for (std::size_t r = 0; r < 3; r++)
+    {
+        readers.emplace_back([&] {
+            std::uint64_t lookups = 0;
+            while (!stop.load() || (lookups < 1000U))
+            {
+                if (!set.contains(static_cast<int>((lookups * 2U) % 256U)))
+                {
+                    failures++;
+                }
+                lookups++;
+            }
+        });
+    }
+    std::set<int> reference;
+    for (std::uint32_t i = 0; i < 20'000U; i++)
+    {
+        const int x = (getRandomByte() | 1);
+        if ((getRandomByte() % 2U) != 0)
+        {
+            set.insert(x);
+            reference.insert(x);
+        }
+        else
+        {
+            set.remove(x);
+            reference.erase(x);
+        }
+    }
+    stop = true;
+    for (auto& t : readers)
+    {
+        t.join();
+    }
+    TEST_ASSERT_EQUAL(0, failures.load());
+    set.flush();
+    TEST_ASSERT_EQUAL(reference.size() + 128U, set.getFrozenSize());
+}
+
+auto waitFrozen(const cavl::AutoFreezing<int>& set) -> bool
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!set.isFrozen())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+void testAutoFreezingBasic()
+{
+    cavl::AutoFreezing<int> set(std::chrono::milliseconds(1));
+    TEST_ASSERT_TRUE(waitFrozen(set));  // An empty set is frozen, too.
+    TEST_ASSERT_FALSE(set.contains(0));
+    // Cover the Eytzinger search for all shapes of the implicit tree up to a few levels deep.
+    std::set<int> reference;
+    for (int n = 1; n <= 70; n++)
+    {
+        const std::uint64_t freezes = set.getFreezeCount();
+        TEST_ASSERT_TRUE(set.insert(n * 2));
+        TEST_ASSERT_FALSE(set.insert(n * 2));
+        // The write has invalidated the snapshot, so any snapshot seen now is a newer one, however late this check is.
+        TEST_ASSERT_TRUE((!set.isFrozen()) || (set.getFreezeCount() > freezes));
+        reference.insert(n * 2);
+        TEST_ASSERT_TRUE(waitFrozen(set));
+        TEST_ASSERT_EQUAL(reference.size(), set.size());
+        for (int x = -1; x <= 143; x++)
+        {
+            int seen = -1;
+            TEST_ASSERT_EQUAL(reference.count(x) > 0U, set.find(x, [&](const int v) { seen = v; }));
+            TEST_ASSERT_TRUE((seen == x) || (seen == -1));
+        }
+    }
+    const std::uint64_t freezes = set.getFreezeCount();
+    TEST_ASSERT_TRUE(set.remove(10));
+    TEST_ASSERT_FALSE(set.remove(10));
+    TEST_ASSERT_TRUE((!set.isFrozen()) || (set.getFreezeCount() > freezes));
+    TEST_ASSERT_FALSE(set.contains(10));
+    TEST_ASSERT_TRUE(set.contains(12));
+    TEST_ASSERT_TRUE(waitFrozen(set));
+    TEST_ASSERT_FALSE(set.contains(10));
+    TEST_ASSERT_TRUE(set.contains(12));
+    TEST_ASSERT_EQUAL(69, set.size());
+
+    // The snapshot of a large set is copied in several chunks.
+    for (int x = 1000; x < 6000; x++)
+    {
+        TEST_ASSERT_TRUE(set.insert(x));
+    }
+    TEST_ASSERT_TRUE(waitFrozen(set));
+    TEST_ASSERT_EQUAL(5069, set.size());
+    for (int x = 143; x < 6001; x++)
+    {
+        TEST_ASSERT_EQUAL((x >= 1000) && (x < 6000), set.contains(x));
+    }
+}
+
+void testAutoFreezingThreaded()
+{
+    cavl::AutoFreezing<int> set(std::chrono::microseconds(100));
+    for (int x = 0; x < 256; x += 2)
+    {
+        set.insert(x);
+    }
+    std::atomic<bool>          stop{false};
+    std::atomic<std::uint64_t> failures{0};
+    std::vector<std::thread>   readers;
+    for (std::size_t r = 0; r < 3; r++)
+    {
+        readers.emplace_back([&] {
+            std::uint64_t lookups = 0;
+            while (!stop.load() || (lookups < 1000U))
+            {
+                if (!set.contains(static_cast<int>((lookups * 2U) % 256U)))
+                {
+                    failures++;
+                }
+                lookups++;
+            }
+        });
+    }
+    std::set<int> reference;
+    for (std::uint32_t i = 0; i < 2'000U; i++)
+    {
+        const int x = (getRandomByte() | 1);
+        if ((getRandomByte() % 2U) != 0)
+        {
+            set.insert(x);
+            reference.insert(x);
+        }
+        else
+        {
+            set.remove(x);
+            reference.erase(x);
+        }
+        if ((i % 100U) == 0U)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));  // Let the set freeze now and then.
+        }
+    }
+    stop = true;
+    for (auto& t : readers)
+    {
+        t.join();
+    }
+    TEST_ASSERT_EQUAL(0, failures.load());
+    TEST_ASSERT_TRUE(waitFrozen(set));
+    TEST_ASSERT_EQUAL(reference.size() + 128U, set.size());
+    for (int x = 1; x < 256; x += 2)
+    {
+        TEST_ASSERT_EQUAL(reference.count(x) > 0U, set.contains(x));
+    }
+}
+
+class Counted final : public cavl::Node<Counted>
+{
+public:
+    Counted(std::atomic<std::size_t>& live, const std::size_t key) : key_(key), live_(live) { live_++; }
+    ~Counted() { live_--; }
+
+    Counted(const Counted&)                    = delete;
+    Counted(Counted&&)                         = delete;
+    auto operator=(const Counted&) -> Counted& = delete;
+    auto operator=(Counted&&) -> Counted&      = delete;
+
+    auto getKey() const -> std::size_t { return key_; }
+
+private:
+    std::size_t               key_;
+    std::atomic<std::size_t>& live_;
+};
+
+void testReclaimer()
+{
+    std::atomic<std::size_t>       live{0};
+    std::vector<std::future<void>> done;
+    {
+        cavl::Reclaimer reclaimer(7);
+        for (const std::size_t count : {0U, 1U, 1000U, 10U})
+        {
+            cavl::Tree<Counted> tree;
+            for (std::size_t i = 0; i < count; i++)
+            {
+                (void) tree.search([i](const Counted& x) { return (i > x.getKey()) ? +1 : -1; },
+                                   [&] { return new Counted(live, i); });  // NOLINT(*-owning-memory)
+            }
+            done.push_back(reclaimer.submit(std::move(tree), [](Counted& x) { delete &x; }));  // NOLINT
+            TEST_ASSERT_TRUE(tree.empty());  // NOLINT(*-use-after-move) The tree is detached in constant time.
+        }
+        done.front().wait();
+        done.back().wait();  // Served round-robin with the large tree submitted before it.
+        // The exception thrown by the visitor is delivered to the submitter.
+        cavl::Tree<Counted> tree;
+        Counted* const      node = new Counted(live, 0);  // NOLINT(*-owning-memory)
+        (void) tree.search([](const Counted& /*unused*/) { return 0; }, [node] { return node; });
+        auto failed = reclaimer.submit(std::move(tree), [](Counted&) { throw std::runtime_error("boom"); });
+        bool thrown = false;
+        try
+        {
+            failed.get();
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        TEST_ASSERT_TRUE(thrown);
+        delete node;  // NOLINT(*-owning-memory) Abandoned by the reclaimer after the visitor has thrown.
+    }
+    // The destructor completes the pending work.
+    for (auto& f : done)
+    {
+        TEST_ASSERT_TRUE(f.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+        f.get();
+    }
+    TEST_ASSERT_EQUAL(0, live.load());
+}
+
+#if defined(CAVL_PROFILING) && CAVL_PROFILING
+
+class Item final : public cavl::Node<Item>
+{
+public:
+    explicit Item(const int val) : value(val) {}
+    int value;
+};
+
+void testHistogram()
+{
+    using cavl::Histogram;
+    for (std::uint64_t v = 0; v < 100'000U; v = (v * 3U / 2U) + 1U)
+    {
+        const auto index = Histogram::getBucketIndex(v);
+        TEST_ASSERT_LESS_THAN(Histogram::BucketCount, index);
+        TEST_ASSERT_GREATER_OR_EQUAL(v, Histogram::getBucketUpperBound(index));
+        TEST_ASSERT_LESS_OR_EQUAL(v + (v / Histogram::SubBucketCount), Histogram::getBucketUpperBound(index));
+        TEST_ASSERT_EQUAL(index, Histogram::getBucketIndex(Histogram::getBucketUpperBound(index)));
+    }
+    TEST_ASSERT_EQUAL(Histogram::BucketCount - 1U, Histogram::getBucketIndex(UINT64_MAX));
+    TEST_ASSERT_EQUAL(UINT64_MAX, Histogram::getBucketUpperBound(Histogram::BucketCount - 1U));
+
+    Histogram hist;
+    TEST_ASSERT_EQUAL(0, hist.getCount());
+    TEST_ASSERT_EQUAL(0, hist.getPercentile(0.5));
+    for (std::uint64_t v = 1; v <= 1000U; v++)
+    {
+        hist.record(v);
+    }
+    TEST_ASSERT_EQUAL(1000, hist.getCount());
+    TEST_ASSERT_EQUAL(1, hist.getMin());
+    TEST_ASSERT_EQUAL(1000, hist.getMax());
+    TEST_ASSERT_EQUAL(1, hist.getPercentile(0.0));
+    TEST_ASSERT_EQUAL(1000, hist.getPercentile(1.0));
+    TEST_ASSERT_GREATER_OR_EQUAL(500, hist.getPercentile(0.5));
+    TEST_ASSERT_LESS_OR_EQUAL(500 + (500 / Histogram::SubBucketCount), hist.getPercentile(0.5));
+    TEST_ASSERT_GREATER_OR_EQUAL(990, hist.getPercentile(0.99));
+    TEST_ASSERT_LESS_OR_EQUAL(990 + (990 / Histogram::SubBucketCount), hist.getPercentile(0.99));
+
+    Histogram other;
+    other.record(5000, 1000);
+    hist.merge(other);
+    TEST_ASSERT_EQUAL(2000, hist.getCount());
+    TEST_ASSERT_EQUAL(5000, hist.getMax());
+    TEST_ASSERT_EQUAL(5000, hist.getPercentile(0.75));
+    hist.reset();
+    TEST_ASSERT_EQUAL(0, hist.getCount());
+    TEST_ASSERT_EQUAL(0, hist.getMin());
+}
+
+void testSamplingProfiler()
+{
+    cavl::Tree<Item>  tree;
+    std::vector<Item> items;
+    items.reserve(10);
+    const auto factory = [&](const int x) {
+        return [&items, x] {
+            items.emplace_back(x);
+            return &items.back();
+        };
+    };
+    const auto predicate = [](const int x) { return [x](const Item& it) { return x - it.value; }; };
+
+    // Nothing is recorded until the profiler is installed.
+    cavl::SamplingProfiler profiler(1);
+    TEST_ASSERT_NULL(tree.search(predicate(0)));
+    TEST_ASSERT_EQUAL(0, profiler.drain([](const cavl::SamplingProfiler::Sample&) {}));
+
+    cavl::Profiler::install(&profiler);
+    for (int x = 0; x < 10; x++)
+    {
+        TEST_ASSERT_NOT_NULL(std::get<0>(tree.search(predicate(x), factory(x))));
+    }
+    for (int x = 0; x < 5; x++)
+    {
+        TEST_ASSERT_NOT_NULL(tree.search(predicate(x)));
+    }
+    for (int x = 0; x < 3; x++)
+    {
+        tree.remove(tree.search(predicate(x)));
+    }
+    tree.traverseInOrder([](const Item&) {});
+    tree.traversePostOrder([](Item&) {});
+
+    std::array<cavl::Histogram, cavl::OperationCount> hist;
+    TEST_ASSERT_EQUAL(10 + 8 + 3 + 2, profiler.drain(hist));
+    TEST_ASSERT_EQUAL(10, hist[static_cast<std::size_t>(cavl::Operation::Insert)].getCount());
+    TEST_ASSERT_EQUAL(8, hist[static_cast<std::size_t>(cavl::Operation::Search)].getCount());
+    TEST_ASSERT_EQUAL(3, hist[static_cast<std::size_t>(cavl::Operation::Remove)].getCount());
+    TEST_ASSERT_EQUAL(2, hist[static_cast<std::size_t>(cavl::Operation::Traverse)].getCount());
+    TEST_ASSERT_EQUAL(0, profiler.drain(hist));
+    TEST_ASSERT_EQUAL(0, profiler.getDropCount());
+    cavl::Profiler::install(nullptr);
+
+    // One in three operations is sampled; the first one is sampled always. The ring holds up to four samples.
+    {
+        cavl::SamplingProfiler sparse(3, 4);
+        cavl::Profiler::install(&sparse);
+        for (int i = 0; i < 9; i++)
+        {
+            (void) tree.search(predicate(i));
+        }
+        std::size_t count = 0;
+        TEST_ASSERT_EQUAL(3, sparse.drain([&](const cavl::SamplingProfiler::Sample& s) {
+            TEST_ASSERT_EQUAL_PTR(&tree, s.tree);
+            TEST_ASSERT_TRUE(cavl::Operation::Search == s.op);
+            count++;
+        }));
+        TEST_ASSERT_EQUAL(3, count);
+        for (int i = 0; i < 30; i++)
+        {
+            (void) tree.search(predicate(i));
+        }
+        TEST_ASSERT_EQUAL(4, sparse.drain(hist));
+        TEST_ASSERT_EQUAL(6, sparse.getDropCount());
+    }
+    TEST_ASSERT_NULL(cavl::Profiler::getInstalled().load());  // Uninstalled by the destructor.
+}
+
+void testSamplingProfilerThreaded()
+{
+    constexpr std::size_t   ThreadCount = 4;
+    constexpr std::uint32_t OpCount     = 10'000;
+    constexpr std::uint32_t Period      = 7;
+    cavl::SamplingProfiler  profiler(Period, 64);
+    cavl::Profiler::install(&profiler);
+    std::atomic<std::size_t> running{ThreadCount};
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < ThreadCount; t++)
+    {
+        threads.emplace_back([&] {
+            cavl::Tree<Item> tree;
+            Item             item(0);
+            (void) tree.search([](const Item&) { return 0; }, [&] { return &item; });
+            for (std::uint32_t i = 1; i < OpCount; i++)
+            {
+                TEST_ASSERT_EQUAL_PTR(&item, tree.search([](const Item&) { return 0; }));
+            }
+            running--;
+        });
+    }
+    std::array<cavl::Histogram, cavl::OperationCount> hist;
+    std::size_t                                       drained = 0;
+    while (running.load() > 0U)
+    {
+        drained += profiler.drain(hist);
+        std::this_thread::yield();
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    drained += profiler.drain(hist);
+    cavl::Profiler::install(nullptr);
+    const std::uint64_t expected = ThreadCount * (((OpCount - 1U) / Period) + 1U);
+    TEST_ASSERT_EQUAL(expected, drained + profiler.getDropCount());
+    TEST_ASSERT_EQUAL(drained,
+                      hist[static_cast<std::size_t>(cavl::Operation::Insert)].getCount() +
+                          hist[static_cast<std::size_t>(cavl::Operation::Search)].getCount());
+}
+
+#endif
+
+}  // namespace
+
+int main(const int argc, const char* const argv[])
+{
+    const auto seed = static_cast<unsigned>((argc > 1) ? std::atoll(argv[1]) : std::time(nullptr));  // NOLINT
+    std::cout << "Randomness seed: " << seed << std::endl;
+    std::srand(seed);
+    // NOLINTBEGIN(misc-include-cleaner)
+    UNITY_BEGIN();
+    RUN_TEST(testReplicatedBasic);
+    RUN_TEST(testReplicatedLogWraparound);
+    RUN_TEST(testReplicatedThreaded);
+    RUN_TEST(testFlatCombinedBasic);
+    RUN_TEST(testFlatCombinedException);
+    RUN_TEST(testFlatCombinedParking);
+    RUN_TEST(testFlatCombinedThreaded);
+    RUN_TEST(testDelegatedBasic);
+    RUN_TEST(testDelegatedParking);
+    RUN_TEST(testDelegatedThreaded);
+    RUN_TEST(testLogStructuredBasic);
+    RUN_TEST(testLogStructuredRandomized);
+    RUN_TEST(testLogStructuredThreaded);
+    RUN_TEST(testAutoFreezingBasic);
+    RUN_TEST(testAutoFreezingThreaded);
+    RUN_TEST(testReclaimer);
+#if defined(CAVL_PROFILING) && CAVL_PROFILING
+    RUN_TEST(testHistogram);
+    RUN_TEST(testSamplingProfiler);
+    RUN_TEST(testSamplingProfilerThreaded);
+#endif
+    return UNITY_END();
+    // NOLINTEND(misc-include-cleaner)
+}
@@ -0,0 +1,373 @@
+/// Copyright (c) 2021 Pavel Kirienko <pavel@uavcan.org>
+
+#include "cavl_containers.hpp"
+
+#include <unity.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+void setUp() {}
+
+void tearDown() {}
+
+namespace
+{
+auto getRandomByte()
+{
+    return static_cast<std::uint8_t>((0xFFLL * std::rand()) / RAND_MAX);
+}
+
+/// Throws from the move constructor of the unlucky value to make its insertion fail.
+struct Fragile final
+{
+    explicit Fragile(const int val) : value(val) {}
+    Fragile(Fragile&& other) : value(other.value)  // NOLINT(*-noexcept-move*)
+    {
+        if (value == 13)
+        {
+            throw std::runtime_error("unlucky");
+        }
+    }
+    Fragile(const Fragile&)                    = delete;
+    ~Fragile()                                 = default;
+    auto operator=(const Fragile&) -> Fragile& = delete;
+    auto operator=(Fragile&&) -> Fragile&      = default;
+
+    auto operator<(const Fragile& other) const -> bool { return value < other.value; }
+
+    int value;
+};
+
+void testCacheObliviousBasic()
+{
+    cavl::CacheOblivious<int> set;
+    TEST_ASSERT_TRUE(set.empty());
+    TEST_ASSERT_FALSE(set.contains(1));
+    TEST_ASSERT_FALSE(set.remove(1));
+    for (int x = 0; x < 1000; x++)
+    {
+        TEST_ASSERT_TRUE(set.insert(x));  // The ascending order makes every insertion land next to the maximum.
+    }
+    TEST_ASSERT_FALSE(set.insert(500));
+    TEST_ASSERT_EQUAL(1000, set.size());
+    TEST_ASSERT_TRUE(set.getCapacity() >= 1000U);
+    int expected = 0;
+    set.traverse([&](const int x) { TEST_ASSERT_EQUAL(expected++, x); });
+    TEST_ASSERT_EQUAL(1000, expected);
+    for (int x = 0; x < 1000; x++)
+    {
+        TEST_ASSERT_TRUE(set.contains(x));
+        TEST_ASSERT_TRUE(set.remove(x));
+        TEST_ASSERT_FALSE(set.contains(x));
+    }
+    TEST_ASSERT_TRUE(set.empty());
+    TEST_ASSERT_EQUAL(16, set.getCapacity());  // Shrunk back.
+}
+
+void testCacheObliviousRandomized()
+{
+    cavl::CacheOblivious<std::uint32_t> set;
+    std::set<std::uint32_t>             reference;
+    std::uint64_t                       inserted = 0;
+    for (std::uint32_t i = 0; i < 100'000U; i++)
+    {
+        const auto x = static_cast<std::uint32_t>((getRandomByte() * 256U) + getRandomByte());
+        // Grow the set during the first half of the run and churn it during the second half.
+        if ((getRandomByte() % 4U) < ((i < 50'000U) ? 3U : 2U))
+        {
+            const bool added = reference.insert(x).second;
+            TEST_ASSERT_EQUAL(added, set.insert(x));
+            inserted += added ? 1U : 0U;
+        }
+        else
+        {
+            TEST_ASSERT_EQUAL(reference.erase(x) > 0U, set.remove(x));
+        }
+        TEST_ASSERT_EQUAL(reference.size(), set.size());
+        if ((i % 5'000U) == 0U)
+        {
+            std::vector<std::uint32_t> values;
+            set.traverse([&](const std::uint32_t v) { values.push_back(v); });
+            TEST_ASSERT_TRUE(std::equal(values.begin(), values.end(), reference.begin(), reference.end()));
+            for (const std::uint32_t v : reference)
+            {
+                TEST_ASSERT_TRUE(set.contains(v));
+            }
+        }
+    }
+    // The amortized number of moves per insertion is O(log^2 n); with n below 2^16 it is far below 256.
+    TEST_ASSERT_TRUE(set.getMoveCount() < (inserted * 64U));
+}
+
+void testCacheObliviousException()
+{
+    cavl::CacheOblivious<Fragile> set;
+    for (int x = 0; x < 10; x++)
+    {
+        TEST_ASSERT_TRUE(set.insert(Fragile(x * 2)));
+    }
+    bool thrown = false;
+    try
+    {
+        (void) set.insert(Fragile(13));
+    }
+    catch (const std::runtime_error&)
+    {
+        thrown = true;
+    }
+    TEST_ASSERT_TRUE(thrown);
+    TEST_ASSERT_EQUAL(10, set.size());
+    // The slot taken for the failed insertion stays empty, so the relocations do not pick up a phantom entry.
+    for (int x = 10; x < 1000; x++)
+    {
+        TEST_ASSERT_TRUE(set.insert(Fragile(x * 2)));
+    }
+    int expected = 0;
+    set.traverse([&](const Fragile& x) {
+        TEST_ASSERT_EQUAL(expected, x.value);
+        expected += 2;
+    });
+    TEST_ASSERT_EQUAL(2000, expected);
+    TEST_ASSERT_FALSE(set.contains(Fragile(13)));
+}
+
+struct Point final
+{
+    std::uint8_t  x;
+    std::uint8_t  y;
+    std::uint32_t id;
+};
+struct GetX final
+{
+    auto operator()(const Point& p) const { return p.x; }
+};
+struct GetY final
+{
+    auto operator()(const Point& p) const { return p.y; }
+};
+using PointTree = cavl::RangeTree2D<Point, GetX, GetY>;
+
+auto queryIds(const PointTree& tree, const int x0, const int x1, const int y0, const int y1)
+{
+    std::vector<std::uint32_t> out;
+    tree.query(static_cast<std::uint8_t>(x0),
+               static_cast<std::uint8_t>(x1),
+               static_cast<std::uint8_t>(y0),
+               static_cast<std::uint8_t>(y1),
+               [&](const Point& p) { out.push_back(p.id); });
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+void testRangeTree2DBasic()
+{
+    PointTree tree;
+    TEST_ASSERT_TRUE(tree.empty());
+    TEST_ASSERT_TRUE(queryIds(tree, 0, 255, 0, 255).empty());
+    tree.rebuild({{5, 5, 0}});
+    TEST_ASSERT_EQUAL(1, tree.size());
+    TEST_ASSERT_EQUAL(1, queryIds(tree, 5, 5, 5, 5).size());
+    TEST_ASSERT_TRUE(queryIds(tree, 0, 4, 0, 255).empty());
+    TEST_ASSERT_TRUE(queryIds(tree, 0, 255, 6, 255).empty());
+
+    // Coincident points and points sharing one coordinate are reported individually.
+    tree.rebuild({{1, 1, 0}, {1, 1, 1}, {1, 2, 2}, {2, 1, 3}, {3, 3, 4}, {0, 9, 5}});
+    TEST_ASSERT_EQUAL(6, tree.size());
+    TEST_ASSERT_TRUE((std::vector<std::uint32_t>{0, 1, 2, 3}) == queryIds(tree, 1, 2, 1, 2));
+    TEST_ASSERT_TRUE((std::vector<std::uint32_t>{0, 1, 3}) == queryIds(tree, 0, 3, 1, 1));
+    TEST_ASSERT_TRUE((std::vector<std::uint32_t>{0, 1, 2}) == queryIds(tree, 1, 1, 0, 255));
+    TEST_ASSERT_TRUE((std::vector<std::uint32_t>{0, 1, 2, 3, 4, 5}) == queryIds(tree, 0, 255, 0, 255));
+    TEST_ASSERT_TRUE(queryIds(tree, 4, 255, 0, 255).empty());
+    TEST_ASSERT_TRUE(queryIds(tree, 2, 1, 0, 255).empty());  // Empty range.
+    tree.rebuild({});
+    TEST_ASSERT_TRUE(tree.empty());
+    TEST_ASSERT_TRUE(queryIds(tree, 0, 255, 0, 255).empty());
+}
+
+void testRangeTree2DRandomized()
+{
+    PointTree tree;
+    for (std::uint32_t round = 0; round < 20U; round++)
+    {
+        std::vector<Point> points((static_cast<std::size_t>(getRandomByte()) * 8U) + 1U);
+        for (std::uint32_t i = 0; i < points.size(); i++)
+        {
+            points.at(i) = {getRandomByte(), getRandomByte(), i};
+        }
+        tree.rebuild(points);
+        TEST_ASSERT_EQUAL(points.size(), tree.size());
+        for (std::uint32_t q = 0; q < 200U; q++)
+        {
+            const std::pair<std::uint8_t, std::uint8_t> x = std::minmax(getRandomByte(), getRandomByte());
+            const std::pair<std::uint8_t, std::uint8_t> y = std::minmax(getRandomByte(), getRandomByte());
+            std::vector<std::uint32_t> reference;
+            for (const Point& p : points)
+            {
+                if ((p.x >= x.first) && (p.x <= x.second) && (p.y >= y.first) && (p.y <= y.second))
+                {
+                    reference.push_back(p.id);
+                }
+            }
+            TEST_ASSERT_TRUE(reference == queryIds(tree, x.first, x.second, y.first, y.second));
+        }
+    }
+}
+
+void testPooledForestBasic()
+{
+    // A non-trivially destructible type ensures that the values are destroyed properly.
+    cavl::PooledForest<std::string> forest(4);
+    const auto                      a = forest.create();
+    const auto                      b = forest.create();
+    TEST_ASSERT_EQUAL(0, a);
+    TEST_ASSERT_EQUAL(1, b);
+    TEST_ASSERT_EQUAL(2, forest.getSetCount());
+    TEST_ASSERT_TRUE(forest.insert(a, "foo"));
+    TEST_ASSERT_TRUE(forest.insert(a, "bar"));
+    TEST_ASSERT_FALSE(forest.insert(a, "foo"));
+    TEST_ASSERT_TRUE(forest.insert(b, "foo"));  // The sets are independent.
+    TEST_ASSERT_EQUAL(3, forest.size());
+    TEST_ASSERT_TRUE(forest.contains(a, "bar"));
+    TEST_ASSERT_FALSE(forest.contains(b, "bar"));
+    std::string found;
+    TEST_ASSERT_TRUE(forest.find(b, "foo", [&](const std::string& x) { found = x; }));
+    TEST_ASSERT_EQUAL_STRING("foo", found.c_str());
+    std::vector<std::string> values;
+    forest.traverse(a, [&](const std::string& x) { values.push_back(x); });
+    TEST_ASSERT_TRUE((values == std::vector<std::string>{"bar", "foo"}));
+    TEST_ASSERT_EQUAL(2, forest.getStats(a).size);
+    TEST_ASSERT_EQUAL(2, forest.getStats(a).height);
+    TEST_ASSERT_EQUAL(0, forest.getStats(forest.create()).size);
+    TEST_ASSERT_TRUE(forest.remove(a, "foo"));
+    TEST_ASSERT_FALSE(forest.remove(a, "foo"));
+    TEST_ASSERT_TRUE(forest.contains(b, "foo"));
+    // The freed nodes are reused, so the pool does not grow.
+    const std::size_t memory = forest.getMemoryUsage();
+    for (int i = 0; i < 100; i++)
+    {
+        TEST_ASSERT_TRUE(forest.insert(b, "baz"));
+        TEST_ASSERT_TRUE(forest.remove(b, "baz"));
+    }
+    TEST_ASSERT_EQUAL(memory, forest.getMemoryUsage());
+    forest.clear(b);
+    TEST_ASSERT_EQUAL(1, forest.size());
+    TEST_ASSERT_FALSE(forest.contains(b, "foo"));
+    TEST_ASSERT_TRUE(forest.insert(b, "foo"));
+    forest.clear();
+    TEST_ASSERT_EQUAL(0, forest.size());
+    TEST_ASSERT_EQUAL(3, forest.getSetCount());
+    TEST_ASSERT_FALSE(forest.contains(a, "bar"));
+}
+
+void testPooledForestRandomized()
+{
+    constexpr std::size_t                SetCount = 1000;
+    cavl::PooledForest<std::uint32_t>    forest(64);
+    std::vector<std::set<std::uint32_t>> references(SetCount);
+    forest.reserve(SetCount);
+    for (std::size_t i = 0; i < SetCount; i++)
+    {
+        TEST_ASSERT_EQUAL(i, forest.create());
+    }
+    for (int round = 0; round < 2; round++)
+    {
+        std::size_t total = 0;
+        for (std::uint32_t i = 0; i < 100'000U; i++)
+        {
+            const auto set = static_cast<std::uint32_t>(((getRandomByte() * 256U) + getRandomByte()) % SetCount);
+            const auto x   = static_cast<std::uint32_t>(getRandomByte() % 16U);
+            if ((getRandomByte() % 3U) != 0U)
+            {
+                const bool added = references.at(set).insert(x).second;
+                TEST_ASSERT_EQUAL(added, forest.insert(set, x));
+                total += added ? 1U : 0U;
+            }
+            else
+            {
+                const bool removed = references.at(set).erase(x) > 0U;
+                TEST_ASSERT_EQUAL(removed, forest.remove(set, x));
+                total -= removed ? 1U : 0U;
+            }
+        }
+        TEST_ASSERT_EQUAL(total, forest.size());
+        for (std::uint32_t set = 0; set < SetCount; set++)
+        {
+            std::vector<std::uint32_t> values;
+            forest.traverse(set, [&](const std::uint32_t v) { values.push_back(v); });
+            const auto& ref = references.at(set);
+            TEST_ASSERT_TRUE(std::equal(values.begin(), values.end(), ref.begin(), ref.end()));
+            const auto stats = forest.getStats(set);
+            TEST_ASSERT_EQUAL(ref.size(), stats.size);
+            TEST_ASSERT_TRUE(stats.height <= 5U);  // An AVL tree of at most 16 nodes.
+        }
+        // Destroy-all releases the whole pool at once; the second round reuses it without allocating.
+        const std::size_t memory = forest.getMemoryUsage();
+        forest.clear();
+        TEST_ASSERT_EQUAL(0, forest.size());
+        TEST_ASSERT_EQUAL(memory, forest.getMemoryUsage());
+        for (auto& ref : references)
+        {
+            ref.clear();
+        }
+    }
+}
+
+void testPooledForestException()
+{
+    cavl::PooledForest<Fragile> forest(1);
+    const auto                  set = forest.create();
+    TEST_ASSERT_TRUE(forest.insert(set, Fragile(1)));
+    // The slot taken for the failed insertion is returned to the pool, so the pool does not grow on repeated failures.
+    std::size_t memory = 0;
+    for (int i = 0; i < 10; i++)
+    {
+        bool thrown = false;
+        try
+        {
+            (void) forest.insert(set, Fragile(13));
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        TEST_ASSERT_TRUE(thrown);
+        memory = (i == 0) ? forest.getMemoryUsage() : memory;
+        TEST_ASSERT_EQUAL(memory, forest.getMemoryUsage());
+    }
+    TEST_ASSERT_EQUAL(1, forest.size());
+    TEST_ASSERT_EQUAL(1, forest.getStats(set).size);
+    TEST_ASSERT_TRUE(forest.insert(set, Fragile(2)));  // Takes the recycled slot.
+    TEST_ASSERT_EQUAL(memory, forest.getMemoryUsage());
+    TEST_ASSERT_TRUE(forest.contains(set, Fragile(1)));
+    TEST_ASSERT_TRUE(forest.contains(set, Fragile(2)));
+}
+
+}  // namespace
+
+int main(const int argc, const char* const argv[])
+{
+    const auto seed = static_cast<unsigned>((argc > 1) ? std::atoll(argv[1]) : std::time(nullptr));  // NOLINT
+    std::cout << "Randomness seed: " << seed << std::endl;
+    std::srand(seed);
+    // NOLINTBEGIN(misc-include-cleaner)
+    UNITY_BEGIN();
+    RUN_TEST(testCacheObliviousBasic);
+    RUN_TEST(testCacheObliviousRandomized);
+    RUN_TEST(testCacheObliviousException);
+    RUN_TEST(testRangeTree2DBasic);
+    RUN_TEST(testRangeTree2DRandomized);
+    RUN_TEST(testPooledForestBasic);
+    RUN_TEST(testPooledForestRandomized);
+    RUN_TEST(testPooledForestException);
+    return UNITY_END();
+    // NOLINTEND(misc-include-cleaner)
+}
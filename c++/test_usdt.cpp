@@ -0,0 +1,155 @@
+/// Copyright (c) 2021 Pavel Kirienko <pavel@uavcan.org>
+///
+/// Verifies that the USDT probes of both cavl.h and cavl.hpp are emitted. The C and the C++ halves are compiled into
+/// separate objects (see c/test_usdt.c), and the ELF notes of each are inspected independently.
+/// The paths to the C and the C++ objects are given on the command line.
+/// This test is built only if <sys/sdt.h> is available.
+
+#include "cavl.hpp"
+
+#include <unity.h>
+
+#include <elf.h>
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#if !(defined(CAVL_PRIVATE_USDT) && CAVL_PRIVATE_USDT)
+#    error "The USDT probes are not enabled"
+#endif
+
+extern "C" std::uint16_t exerciseC();
+
+void setUp() {}
+
+void tearDown() {}
+
+// NOLINTBEGIN(*-reinterpret-cast, *-pointer-arithmetic) the ELF image is parsed in place.
+namespace
+{
+constexpr std::uint32_t StapSDTNoteType = 3;
+
+/// Maps probe names of the "cavl" provider to the number of probe sites.
+auto readProbes(const std::string& path) -> std::map<std::string, std::size_t>
+{
+    std::ifstream                    file(path, std::ios::binary);
+    const std::vector<unsigned char> image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    TEST_ASSERT_TRUE(image.size() > sizeof(Elf64_Ehdr));
+    const auto read = [&image](const std::size_t offset, auto& out) {
+        TEST_ASSERT_TRUE((offset + sizeof(out)) <= image.size());
+        std::memcpy(&out, &image.at(offset), sizeof(out));
+    };
+    Elf64_Ehdr ehdr{};
+    read(0, ehdr);
+    TEST_ASSERT_EQUAL_MEMORY(ELFMAG, ehdr.e_ident, SELFMAG);
+    TEST_ASSERT_EQUAL(ELFCLASS64, ehdr.e_ident[EI_CLASS]);
+    std::vector<Elf64_Shdr> sections(ehdr.e_shnum);
+    for (std::size_t i = 0; i < sections.size(); i++)
+    {
+        read(ehdr.e_shoff + (i * ehdr.e_shentsize), sections.at(i));
+    }
+    const Elf64_Shdr& names = sections.at(ehdr.e_shstrndx);
+
+    std::map<std::string, std::size_t> out;
+    for (const Elf64_Shdr& sec : sections)
+    {
+        const auto* const name = reinterpret_cast<const char*>(&image.at(names.sh_offset + sec.sh_name));
+        if ((sec.sh_type != SHT_NOTE) || (std::strcmp(name, ".note.stapsdt") != 0))
+        {
+            continue;
+        }
+        std::size_t offset = sec.sh_offset;
+        while (offset < (sec.sh_offset + sec.sh_size))
+        {
+            Elf64_Nhdr nhdr{};
+            read(offset, nhdr);
+            const std::size_t name_offset = offset + sizeof(nhdr);
+            const std::size_t desc_offset = name_offset + ((nhdr.n_namesz + 3U) & ~3U);
+            offset                        = desc_offset + ((nhdr.n_descsz + 3U) & ~3U);
+            const auto* const owner       = reinterpret_cast<const char*>(&image.at(name_offset));
+            if ((nhdr.n_type == StapSDTNoteType) && (std::strcmp(owner, "stapsdt") == 0))
+            {
+                // The descriptor is: PC, base address, semaphore address, provider, name, argument format.
+                const auto* const provider = reinterpret_cast<const char*>(&image.at(desc_offset + (3 * 8U)));
+                const auto* const probe    = provider + std::strlen(provider) + 1U;
+                if (std::strcmp(provider, "cavl") == 0)
+                {
+                    out[probe]++;
+                }
+            }
+        }
+    }
+    return out;
+}
+
+// Instantiate the C++ templates so that their probes are emitted.
+class My : public cavl::Node<My>
+{
+public:
+    My() = default;
+    std::uint16_t value = 0;
+};
+
+std::array<const char*, 2> objects{};  // NOLINT(*-avoid-non-const-global-variables) the C and the C++ objects.
+
+constexpr std::array<const char*, 6> ProbeNames{
+    {"search_entry", "search_return", "insert_return", "remove_entry", "remove_return", "rotate"}};
+
+void checkProbes(const char* const path)
+{
+    TEST_ASSERT_NOT_NULL(path);
+    const auto probes = readProbes(path);
+    for (const char* const name : ProbeNames)
+    {
+        const auto it = probes.find(name);
+        TEST_ASSERT_TRUE_MESSAGE(it != probes.end(), name);
+        TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(1, it->second, name);
+    }
+}
+
+void testProbesPresentC()
+{
+    TEST_ASSERT_EQUAL(31, exerciseC());
+    checkProbes(objects.at(0));
+}
+
+void testProbesPresentCpp()
+{
+    std::array<My, 32> nodes{};
+    cavl::Tree<My>     tree;
+    for (std::uint16_t i = 0; i < 32U; i++)
+    {
+        nodes.at(i).value = i;
+        const auto pred   = [i](const My& x) { return static_cast<int>(i) - static_cast<int>(x.value); };
+        TEST_ASSERT_FALSE(std::get<1>(tree.search(pred, [&] { return &nodes.at(i); })));
+        TEST_ASSERT_EQUAL_PTR(&nodes.at(i), tree.search(pred));
+    }
+    tree.remove(&nodes.at(7));
+    TEST_ASSERT_EQUAL(31, tree.size());
+    checkProbes(objects.at(1));
+}
+
+}  // namespace
+// NOLINTEND(*-reinterpret-cast, *-pointer-arithmetic)
+
+int main(const int argc, const char* const argv[])
+{
+    if (argc != 3)
+    {
+        std::fprintf(stderr, "Usage: %s <C object> <C++ object>\n", argv[0]);  // NOLINT(*-vararg)
+        return 1;
+    }
+    objects = {argv[1], argv[2]};  // NOLINT(*-pointer-arithmetic)
+    UNITY_BEGIN();
+    RUN_TEST(testProbesPresentC);
+    RUN_TEST(testProbesPresentCpp);
+    return UNITY_END();
+}
@@ -38,6 +38,68 @@
 #    endif
 #endif
 
+/// Optional USDT probes for tracing live processes using bpftrace, perf, or SystemTap; see tools/cavl.bt.
+/// The probes are enabled if CAVL_USDT is defined to a nonzero value and <sys/sdt.h> is available;
+/// otherwise, they are compiled out. While no tracer is attached, each probe site is a single NOP instruction.
+/// The definitions are kept identical to those in cavl.hpp, so that both headers can be included together.
+#ifndef CAVL_PRIVATE_PROBE1
+#    if defined(CAVL_USDT) && CAVL_USDT && defined(__has_include)
+#        if __has_include(<sys/sdt.h>)
+#            ifndef _SYS_SDT_H
+#                define _SDT_HAS_SEMAPHORES 1
+#            endif
+#            include <sys/sdt.h>
+#            define CAVL_PRIVATE_USDT 1
+#        endif
+#    endif
+#    if defined(CAVL_PRIVATE_USDT)
+#        define CAVL_PRIVATE_PROBE1(name, a) DTRACE_PROBE1(cavl, name, a)
+#        define CAVL_PRIVATE_PROBE2(name, a, b) DTRACE_PROBE2(cavl, name, a, b)
+#        define CAVL_PRIVATE_PROBE3(name, a, b, c) DTRACE_PROBE3(cavl, name, a, b, c)
+#    else
+#        define CAVL_PRIVATE_PROBE1(name, a) ((void) (a))
+#        define CAVL_PRIVATE_PROBE2(name, a, b) ((void) (a), (void) (b))
+#        define CAVL_PRIVATE_PROBE3(name, a, b, c) ((void) (a), (void) (b), (void) (c))
+#    endif
+// A probe whose arguments are costly to compute is guarded by CAVL_PRIVATE_PROBE_ENABLED(name), which reads the
+// semaphore that the tracer increments while attached. The semaphores are weak, so every translation unit may
+// define them. If <sys/sdt.h> has been included earlier without the semaphore support, the probes are always on.
+#    if defined(CAVL_PRIVATE_USDT) && defined(_SDT_HAS_SEMAPHORES)
+#        define CAVL_PRIVATE_SEMAPHORE(name) \
+            __attribute__((weak, section(".probes"), visibility("hidden"))) unsigned short cavl_##name##_semaphore = 0
+#        ifdef __cplusplus
+extern "C" {
+#        endif
+CAVL_PRIVATE_SEMAPHORE(search_entry);
+CAVL_PRIVATE_SEMAPHORE(search_return);
+CAVL_PRIVATE_SEMAPHORE(insert_return);
+CAVL_PRIVATE_SEMAPHORE(remove_entry);
+CAVL_PRIVATE_SEMAPHORE(remove_return);
+CAVL_PRIVATE_SEMAPHORE(rotate);
+#        ifdef __cplusplus
+}
+#        endif
+#        define CAVL_PRIVATE_PROBE_ENABLED(name) \
+            __builtin_expect(*(const volatile unsigned short*) &cavl_##name##_semaphore != 0, 0)
+#    elif defined(CAVL_PRIVATE_USDT)
+#        define CAVL_PRIVATE_PROBE_ENABLED(name) 1
+#    else
+#        define CAVL_PRIVATE_PROBE_ENABLED(name) 0
+#    endif
+#endif
+
+/// Optional augmentation hook. If CAVL_AUGMENT(node) is defined before this header is included, it is invoked with
+/// a (Cavl*) argument whenever the set of the descendants of the node may have changed, after its children have been
+/// updated. This allows the application to maintain per-subtree aggregates in its nodes, such as the subtree size
+/// required by cavlSelect() and cavlRank(). The hook is invoked on every node on the path from the modified node
+/// to the root upon insertion and removal, and on the rotated nodes upon rebalancing, so it shall be cheap.
+/// A per-tree behavior can be achieved by dispatching through a function pointer stored in the nodes.
+#ifdef CAVL_AUGMENT
+#    define CAVL_PRIVATE_AUGMENTED 1
+#else
+#    define CAVL_AUGMENT(node) (void) 0
+#endif
+
 #ifdef __cplusplus
 // This is, strictly speaking, useless because we do not define any functions with external linkage here,
 // but it tells static analyzers that what follows should be interpreted as C code rather than C++.
@@ -104,13 +166,109 @@ static inline Cavl* cavlFindExtremum(Cavl* const root, const bool maximum)
     return result;
 }
 
+/// Returns the size of the subtree rooted at the specified node, which shall not be NULL; see CAVL_AUGMENT.
+typedef size_t (*CavlSubtreeSize)(const Cavl* node);
+
+/// Order-statistic queries for trees augmented with the subtree size. The worst-case complexity is O(log n).
+/// cavlSelect() returns the node at the specified zero-based in-order index, or NULL if the index is out of range.
+/// cavlRank() returns the zero-based in-order index of the node in its tree. The node shall not be NULL.
+static inline Cavl* cavlSelect(Cavl* const root, const size_t index, const CavlSubtreeSize size)
+{
+    Cavl*  n = root;
+    size_t i = index;
+    while (n != NULL)
+    {
+        const size_t left = (n->lr[0] != NULL) ? size(n->lr[0]) : 0U;
+        if (i == left)
+        {
+            break;
+        }
+        if (i < left)
+        {
+            n = n->lr[0];
+        }
+        else
+        {
+            i -= left + 1U;
+            n = n->lr[1];
+        }
+    }
+    return n;
+}
+static inline size_t cavlRank(const Cavl* const node, const CavlSubtreeSize size)
+{
+    CAVL_ASSERT(node != NULL);
+    size_t      out = (node->lr[0] != NULL) ? size(node->lr[0]) : 0U;
+    const Cavl* c   = node;
+    while (c->up != NULL)
+    {
+        if (c->up->lr[1] == c)
+        {
+            out += 1U + ((c->up->lr[0] != NULL) ? size(c->up->lr[0]) : 0U);
+        }
+        c = c->up;
+    }
+    return out;
+}
+
+/// Returns POSITIVE if the search target is GREATER than the provided key, negative if smaller, zero on match (found).
+/// The key points to an element of the array passed to cavlStaticSearch().
+typedef int8_t (*CavlStaticPredicate)(void* user_reference, const void* key);
+
+/// Look for a key in a static tree stored without pointers, e.g., as a constant table in ROM. The tree is an array
+/// of `count` keys of `key_size` bytes each arranged in the level order of a complete binary search tree (the
+/// Eytzinger layout): the children of the key at index i are at 2i+1 (lesser) and 2i+2 (greater). The shape is
+/// implied by the count, so the table holds nothing but the keys. Such tables can be generated offline from
+/// a populated tree using cavl::Tree<>::encodeLevelOrder() from cavl.hpp.
+/// Returns the index of the matching key, or `count` if there is none or the predicate is NULL.
+/// The user_reference is passed into the predicate unmodified. The worst-case complexity is O(log n).
+static inline size_t cavlStaticSearch(const void* const         keys,
+                                      const size_t              count,
+                                      const size_t              key_size,
+                                      void* const               user_reference,
+                                      const CavlStaticPredicate predicate)
+{
+    size_t out = count;
+    size_t i   = 0U;
+    if ((keys != NULL) && (predicate != NULL))
+    {
+        while ((i < count) && (out == count))
+        {
+            const int8_t cmp = predicate(user_reference, ((const uint8_t*) keys) + (i * key_size));
+            if (0 == cmp)
+            {
+                out = i;
+            }
+            else
+            {
+                i = (2U * i) + ((cmp > 0) ? 2U : 1U);
+            }
+        }
+    }
+    return out;
+}
+
 // ----------------------------------------     END OF PUBLIC API SECTION      ----------------------------------------
 // ----------------------------------------      POLICE LINE DO NOT CROSS      ----------------------------------------
 
+/// INTERNAL USE ONLY. Invokes the augmentation hook on the node and all of its ancestors, if the hook is defined.
+static inline void cavlPrivateAugmentPath(Cavl* const node)
+{
+#ifdef CAVL_PRIVATE_AUGMENTED
+    for (Cavl* a = node; a != NULL; a = a->up)
+    {
+        CAVL_AUGMENT(a);
+    }
+#else
+    (void) node;
+#endif
+}
+
 /// INTERNAL USE ONLY. Makes the '!r' child of node 'x' its parent; i.e., rotates 'x' toward 'r'.
 static inline void cavlPrivateRotate(Cavl* const x, const bool r)
 {
     CAVL_ASSERT((x != NULL) && (x->lr[!r] != NULL) && ((x->bf >= -1) && (x->bf <= +1)));
+    CAVL_PRIVATE_PROBE2(rotate, x, (int) r);
     Cavl* const z = x->lr[!r];
     if (x->up != NULL)
     {
@@ -124,6 +282,10 @@ static inline void cavlPrivateRotate(Cavl* const x, const bool r)
         x->lr[!r]->up = x;
     }
     z->lr[r] = x;
+#ifdef CAVL_PRIVATE_AUGMENTED
+    CAVL_AUGMENT(x);  // Now a child of z, so it goes first.
+    CAVL_AUGMENT(z);
+#endif
 }
 
 /// INTERNAL USE ONLY.
@@ -219,10 +381,13 @@ static inline Cavl* cavlSearch(Cavl** const        root,
     Cavl* out = NULL;
     if ((root != NULL) && (predicate != NULL))
     {
-        Cavl*  up = *root;
-        Cavl** n  = root;
+        CAVL_PRIVATE_PROBE1(search_entry, root);
+        Cavl*  up    = *root;
+        Cavl** n     = root;
+        size_t depth = 0;  // The number of nodes visited.
         while (*n != NULL)
         {
+            depth++;
             const int8_t cmp = predicate(user_reference, *n);
             if (0 == cmp)
             {
@@ -243,12 +408,22 @@ static inline Cavl* cavlSearch(Cavl** const        root,
                 out->lr[1]     = NULL;
                 out->up        = up;
                 out->bf        = 0;
+                cavlPrivateAugmentPath(out);  // Before the rotations so that they see up-to-date children.
                 Cavl* const rt = cavlPrivateRetraceOnGrowth(out);
                 if (rt != NULL)
                 {
                     *root = rt;
                 }
+                CAVL_PRIVATE_PROBE3(insert_return, root, depth, out);
             }
+            else
+            {
+                CAVL_PRIVATE_PROBE3(search_return, root, depth, out);
+            }
+        }
+        else
+        {
+            CAVL_PRIVATE_PROBE3(search_return, root, depth, out);
         }
     }
     return out;
@@ -260,8 +435,10 @@ static inline void cavlRemove(Cavl** const root, const Cavl* const node)
     {
         CAVL_ASSERT(*root != NULL);  // Otherwise, the node would have to be NULL.
         CAVL_ASSERT((node->up != NULL) || (node == *root));
-        Cavl* p = NULL;   // The lowest parent node that suffered a shortening of its subtree.
-        bool  r = false;  // Which side of the above was shortened.
+        CAVL_PRIVATE_PROBE2(remove_entry, root, node);
+        Cavl*  p     = NULL;   // The lowest parent node that suffered a shortening of its subtree.
+        bool   r     = false;  // Which side of the above was shortened.
+        size_t depth = 0;      // The number of nodes visited while retracing.
         // The first step is to update the topology and remember the node where to start the retracing from later.
         // Balancing is not performed yet so we may end up with an unbalanced tree.
         if ((node->lr[0] != NULL) && (node->lr[1] != NULL))
@@ -321,6 +498,7 @@ static inline void cavlRemove(Cavl** const root, const Cavl* const node)
                 *root = node->lr[rr];
             }
         }
+        cavlPrivateAugmentPath(p);  // Before the rotations so that they see up-to-date children.
         // Now that the topology is updated, perform the retracing to restore balance. We climb up adjusting the
         // balance factors until we reach the root or a parent whose balance factor becomes plus/minus one, which
         // means that that parent was able to absorb the balance delta; in other words, the height of the outer
@@ -330,6 +508,7 @@ static inline void cavlRemove(Cavl** const root, const Cavl* const node)
             Cavl* c = NULL;
             for (;;)
             {
+                depth++;
                 c = cavlPrivateAdjustBalance(p, !r);
                 p = c->up;
                 if ((c->bf != 0) || (NULL == p))  // Reached the root or the height difference is absorbed by c.
@@ -344,6 +523,7 @@ static inline void cavlRemove(Cavl** const root, const Cavl* const node)
                 *root = c;
             }
         }
+        CAVL_PRIVATE_PROBE2(remove_return, root, depth);
     }
 }
 
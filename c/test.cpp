@@ -1,5 +1,13 @@
 /// Copyright (c) 2021 Pavel Kirienko <pavel@uavcan.org>
 
+/// The augmentation hook is dispatched through a pointer that is set only by the augmentation test.
+struct Cavl;
+namespace
+{
+void (*augmentHook)(Cavl* node) = nullptr;  // NOLINT(*-avoid-non-const-global-variables)
+}  // namespace
+#define CAVL_AUGMENT(node) ((augmentHook != nullptr) ? augmentHook(node) : (void) 0)
+
 #include "cavl.h"
 #include <unity.h>
 #include <algorithm>
@@ -10,6 +18,8 @@
 #include <ctime>
 #include <optional>
 #include <numeric>
+#include <set>
+#include <vector>
 
 void setUp() {}
 
@@ -1402,6 +1412,126 @@ void testMutationRandomized()
     validate();
 }
 
+void testAugmentation()
+{
+    struct Sized final : Cavl
+    {
+        std::uint8_t value = 0;
+        std::size_t  size  = 0;  // Maintained by the augmentation hook.
+    };
+    struct Context final
+    {
+        std::uint8_t            key;
+        std::array<Sized, 256>* pool;
+    };
+    static const CavlSubtreeSize get_size = [](const Cavl* const n) { return static_cast<const Sized*>(n)->size; };
+    const auto                   compute  = [](const Cavl* const n) {
+        return 1U + ((n->lr[0] != nullptr) ? get_size(n->lr[0]) : 0U) +
+               ((n->lr[1] != nullptr) ? get_size(n->lr[1]) : 0U);
+    };
+    augmentHook = [](Cavl* const n) {
+        static_cast<Sized*>(n)->size = 1U + ((n->lr[0] != nullptr) ? get_size(n->lr[0]) : 0U) +
+                                       ((n->lr[1] != nullptr) ? get_size(n->lr[1]) : 0U);
+    };
+    const CavlPredicate predicate = [](void* const ref, const Cavl* const n) -> std::int8_t {
+        const auto a = static_cast<const Context*>(ref)->key;
+        const auto b = static_cast<const Sized*>(n)->value;
+        return static_cast<std::int8_t>((a > b) - (a < b));
+    };
+    const CavlFactory factory = [](void* const ref) -> Cavl* {
+        const auto* const ctx = static_cast<const Context*>(ref);
+        return &ctx->pool->at(ctx->key);
+    };
+
+    std::array<Sized, 256> t{};
+    for (std::size_t i = 0; i < t.size(); i++)
+    {
+        t.at(i).value = static_cast<std::uint8_t>(i);
+    }
+    Cavl*                  root = nullptr;
+    std::set<std::uint8_t> reference;
+    const auto             validate = [&] {
+        std::size_t index = 0;
+        for (const std::uint8_t x : reference)
+        {
+            const Sized& n = t.at(x);
+            TEST_ASSERT_EQUAL(compute(&n), n.size);
+            TEST_ASSERT_EQUAL_PTR(&n, cavlSelect(root, index, get_size));
+            TEST_ASSERT_EQUAL(index, cavlRank(&n, get_size));
+            index++;
+        }
+        TEST_ASSERT_NULL(cavlSelect(root, reference.size(), get_size));
+        TEST_ASSERT_EQUAL(reference.size(), (root != nullptr) ? get_size(root) : 0U);
+    };
+    validate();
+    for (std::uint32_t i = 0; i < 10'000U; i++)
+    {
+        Context ctx{getRandomByte(), &t};
+        if ((getRandomByte() % 2U) != 0)
+        {
+            TEST_ASSERT_EQUAL_PTR(&t.at(ctx.key), cavlSearch(&root, &ctx, predicate, factory));
+            reference.insert(ctx.key);
+        }
+        else
+        {
+            cavlRemove(&root, cavlSearch(&root, &ctx, predicate, nullptr));
+            reference.erase(ctx.key);
+        }
+        validate();
+    }
+    augmentHook = nullptr;
+}
+
+void testStaticSearch()
+{
+    const CavlStaticPredicate predicate = [](void* const ref, const void* const key) -> std::int8_t {
+        const auto a = *static_cast<const std::uint16_t*>(ref);
+        const auto b = *static_cast<const std::uint16_t*>(key);
+        return static_cast<std::int8_t>((a > b) - (a < b));
+    };
+    // A hand-made table as it would be placed in ROM: 1..7 in the level order.
+    static const std::array<std::uint16_t, 7> rom{{4, 2, 6, 1, 3, 5, 7}};
+    for (std::uint16_t key = 0; key <= 8U; key++)
+    {
+        const std::size_t index = cavlStaticSearch(rom.data(), rom.size(), sizeof(std::uint16_t), &key, predicate);
+        if ((key >= 1U) && (key <= 7U))
+        {
+            TEST_ASSERT_EQUAL(key, rom.at(index));
+        }
+        else
+        {
+            TEST_ASSERT_EQUAL(rom.size(), index);
+        }
+    }
+    std::uint16_t key = 4;
+    TEST_ASSERT_EQUAL(7, cavlStaticSearch(rom.data(), rom.size(), sizeof(std::uint16_t), &key, nullptr));
+    TEST_ASSERT_EQUAL(0, cavlStaticSearch(rom.data(), 0, sizeof(std::uint16_t), &key, predicate));
+
+    // Every table size: the even numbers 2..2n laid out by an in-order walk of the implicit complete tree.
+    for (std::size_t n = 0; n <= 130U; n++)
+    {
+        std::vector<std::uint16_t> table(n);
+        std::uint16_t              next = 2;
+        const auto                 fill = [&](const auto& self, const std::size_t index) -> void {
+            if (index < n)
+            {
+                self(self, (2U * index) + 1U);
+                table.at(index) = next;
+                next            = static_cast<std::uint16_t>(next + 2U);
+                self(self, (2U * index) + 2U);
+            }
+        };
+        fill(fill, 0);
+        for (key = 0; key <= ((2U * n) + 2U); key++)
+        {
+            const std::size_t index = cavlStaticSearch(table.data(), n, sizeof(std::uint16_t), &key, predicate);
+            const bool        found = (key >= 2U) && (key <= (2U * n)) && ((key % 2U) == 0U);
+            TEST_ASSERT_EQUAL(found ? key : 0U, (index < n) ? table.at(index) : 0U);
+            TEST_ASSERT_EQUAL(found, index < n);
+        }
+    }
+}
+
 }  // namespace
 
 int main(const int argc, const char* const argv[])
@@ -1421,6 +1551,8 @@ int main(const int argc, const char* const argv[])
     RUN_TEST(testRemovalA);
     RUN_TEST(testMutationManual);
     RUN_TEST(testMutationRandomized);
+    RUN_TEST(testAugmentation);
+    RUN_TEST(testStaticSearch);
     return UNITY_END();
     // NOLINTEND(misc-include-cleaner)
 }
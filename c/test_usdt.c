@@ -0,0 +1,49 @@
+/// Copyright (c) 2021 Pavel Kirienko <pavel@uavcan.org>
+///
+/// The C half of the USDT probe test: it is compiled as C into a separate object, whose ELF notes are then inspected
+/// by c++/test_usdt.cpp. This file uses only cavl.h, so the probes found in its object can only come from cavl.h.
+
+#include "cavl.h"
+
+#include <stdint.h>
+
+#if !(defined(CAVL_PRIVATE_USDT) && CAVL_PRIVATE_USDT)
+#    error "The USDT probes are not enabled"
+#endif
+
+typedef struct
+{
+    Cavl     base;
+    uint16_t value;
+} CNode;
+
+static int8_t compare(void* const ref, const Cavl* const node)
+{
+    const uint16_t a = ((const CNode*) ref)->value;
+    const uint16_t b = ((const CNode*) node)->value;
+    return (int8_t) ((a > b) - (a < b));
+}
+
+static Cavl* factory(void* const ref)
+{
+    return &((CNode*) ref)->base;
+}
+
+/// Builds a tree of a few nodes and removes one of them; returns the number of nodes left in the tree.
+uint16_t exerciseC(void);
+uint16_t exerciseC(void)
+{
+    static CNode nodes[32];
+    Cavl*        root = NULL;
+    uint16_t     size = 0;
+    for (uint16_t i = 0; i < 32U; i++)
+    {
+        nodes[i].value = i;
+        if (cavlSearch(&root, &nodes[i], &compare, &factory) == &nodes[i].base)
+        {
+            size++;
+        }
+    }
+    cavlRemove(&root, &nodes[7].base);
+    return (uint16_t) (size - 1U);
+}
@@ -0,0 +1,509 @@
+/// Copyright (c) 2021 Pavel Kirienko <pavel@uavcan.org>
+///
+/// Compares two benchmark result files produced by benchmark_cpp --json=FILE and tells whether the differences
+/// are statistically significant. Each variant of each scenario shall be measured repeatedly in both files
+/// (see --repetitions=N); the samples are compared with the two-sided Mann-Whitney U test, which makes no
+/// assumptions about the distribution of the measurements and is robust against outliers.
+///
+/// Usage: bench_compare BASELINE.json CANDIDATE.json [threshold_percent [alpha]]
+///
+/// A variant is a regression if its median time per operation grew by more than the threshold (5% by default)
+/// and the difference is significant at the level alpha (0.05 by default). Significant changes below the threshold
+/// are reported but not flagged. The exit code is 0 if there are no regressions, 1 if there are, 2 on error.
+/// Five or more repetitions per file are recommended; with fewer the test cannot reach the default significance.
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace
+{
+using Key     = std::tuple<std::string, std::string, std::string>;  // Scenario, variant, parameters.
+using Samples = std::map<Key, std::vector<double>>;
+
+/// A minimal reader of the subset of JSON emitted by the benchmark. Throws std::runtime_error on malformed input.
+class Reader final
+{
+public:
+    explicit Reader(std::string text) : text_(std::move(text)) {}
+
+    template <typename F>
+    void readObject(const F& on_member)
+    {
+        expect('{');
+        if (consume('}'))
+        {
+            return;
+        }
+        do
+        {
+            const std::string key = readString();
+            expect(':');
+            on_member(key);
+        } while (consume(','));
+        expect('}');
+    }
+
+    template <typename F>
+    void readArray(const F& on_item)
+    {
+        expect('[');
+        if (consume(']'))
+        {
+            return;
+        }
+        do
+        {
+            on_item();
+        } while (consume(','));
+        expect(']');
+    }
+
+    auto readString() -> std::string
+    {
+        expect('"');
+        std::string out;
+        while (peekRaw() != '"')
+        {
+            char c = text_.at(pos_++);
+            if (c == '\\')
+            {
+                c = peekRaw();
+                pos_++;
+                if (c == 'u')
+                {
+                    appendUtf8(readCodePoint(), out);
+                    continue;
+                }
+                const std::string escapes = "\"\"\\\\//b\bf\fn\nr\rt\t";
+                const auto        it      = escapes.find(c);
+                if ((it == std::string::npos) || ((it % 2U) != 0U))
+                {
+                    fail("invalid escape sequence");
+                }
+                c = escapes.at(it + 1U);
+            }
+            out += c;
+        }
+        pos_++;
+        return out;
+    }
+
+    auto readNumber() -> double
+    {
+        skipSpace();
+        const char* const begin = text_.c_str() + pos_;  // NOLINT(*-pointer-arithmetic)
+        char*             end   = nullptr;
+        const double      out   = std::strtod(begin, &end);
+        if (end == begin)
+        {
+            fail("number expected");
+        }
+        pos_ += static_cast<std::size_t>(end - begin);
+        return out;
+    }
+
+    /// Skips a value of any type, which is used to ignore unknown members for forward compatibility.
+    void skipValue()
+    {
+        const char c = peek();
+        if (c == '{')
+        {
+            readObject([this](const std::string& /*unused*/) { skipValue(); });
+        }
+        else if (c == '[')
+        {
+            readArray([this] { skipValue(); });
+        }
+        else if (c == '"')
+        {
+            (void) readString();
+        }
+        else if ((c == 't') || (c == 'f') || (c == 'n'))
+        {
+            while ((pos_ < text_.size()) && (std::isalpha(static_cast<unsigned char>(text_.at(pos_))) != 0))
+            {
+                pos_++;
+            }
+        }
+        else
+        {
+            (void) readNumber();
+        }
+    }
+
+private:
+    /// Reads the hex digits of a \\u escape, combining a surrogate pair into one code point.
+    auto readCodePoint() -> std::uint32_t
+    {
+        const std::uint32_t high = readHex4();
+        if ((high >= 0xDC00U) && (high <= 0xDFFFU))
+        {
+            fail("unpaired low surrogate");
+        }
+        if ((high < 0xD800U) || (high > 0xDBFFU))
+        {
+            return high;
+        }
+        if (text_.compare(pos_, 2, "\\u") != 0)
+        {
+            fail("unpaired high surrogate");
+        }
+        pos_ += 2;
+        const std::uint32_t low = readHex4();
+        if ((low < 0xDC00U) || (low > 0xDFFFU))
+        {
+            fail("unpaired high surrogate");
+        }
+        return 0x10000U + ((high - 0xD800U) << 10U) + (low - 0xDC00U);
+    }
+
+    auto readHex4() -> std::uint32_t
+    {
+        std::uint32_t out = 0;
+        for (std::size_t i = 0; i < 4U; i++)
+        {
+            const char c = peekRaw();
+            if (std::isxdigit(static_cast<unsigned char>(c)) == 0)
+            {
+                fail("hex digit expected");
+            }
+            pos_++;
+            const int digit = (c <= '9') ? (c - '0') : (std::tolower(static_cast<unsigned char>(c)) - 'a' + 10);
+            out             = (out << 4U) | static_cast<std::uint32_t>(digit);
+        }
+        return out;
+    }
+
+    static void appendUtf8(const std::uint32_t cp, std::string& out)
+    {
+        const auto put = [&out](const std::uint32_t x) { out += static_cast<char>(static_cast<unsigned char>(x)); };
+        if (cp < 0x80U)
+        {
+            put(cp);
+        }
+        else if (cp < 0x800U)
+        {
+            put(0xC0U | (cp >> 6U));
+            put(0x80U | (cp & 0x3FU));
+        }
+        else if (cp < 0x10000U)
+        {
+            put(0xE0U | (cp >> 12U));
+            put(0x80U | ((cp >> 6U) & 0x3FU));
+            put(0x80U | (cp & 0x3FU));
+        }
+        else
+        {
+            put(0xF0U | (cp >> 18U));
+            put(0x80U | ((cp >> 12U) & 0x3FU));
+            put(0x80U | ((cp >> 6U) & 0x3FU));
+            put(0x80U | (cp & 0x3FU));
+        }
+    }
+
+    [[noreturn]] void fail(const std::string& what) const
+    {
+        throw std::runtime_error(what + " at offset " + std::to_string(pos_));
+    }
+
+    void skipSpace()
+    {
+        while ((pos_ < text_.size()) && (std::isspace(static_cast<unsigned char>(text_.at(pos_))) != 0))
+        {
+            pos_++;
+        }
+    }
+
+    auto peek() -> char
+    {
+        skipSpace();
+        if (pos_ >= text_.size())
+        {
+            fail("unexpected end of input");
+        }
+        return text_.at(pos_);
+    }
+
+    /// Unlike peek(), does not skip the whitespace, which is significant inside strings.
+    auto peekRaw() -> char
+    {
+        if (pos_ >= text_.size())
+        {
+            fail("unexpected end of input");
+        }
+        return text_.at(pos_);
+    }
+
+    auto consume(const char c) -> bool
+    {
+        if (peek() == c)
+        {
+            pos_++;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(const char c)
+    {
+        if (!consume(c))
+        {
+            fail(std::string("'") + c + "' expected");
+        }
+    }
+
+    const std::string text_;
+    std::size_t       pos_ = 0;
+};
+
+auto load(const std::string& path) -> Samples
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        throw std::runtime_error("cannot open " + path);
+    }
+    Reader  reader(std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()));
+    Samples out;
+    reader.readObject([&](const std::string& key) {
+        if (key != "results")
+        {
+            reader.skipValue();
+            return;
+        }
+        reader.readArray([&] {
+            Key                 id;
+            std::vector<double> values;
+            reader.readObject([&](const std::string& member) {
+                if (member == "scenario")
+                {
+                    std::get<0>(id) = reader.readString();
+                }
+                else if (member == "variant")
+                {
+                    std::get<1>(id) = reader.readString();
+                }
+                else if (member == "params")
+                {
+                    std::get<2>(id) = reader.readString();
+                }
+                else if (member == "ns_per_op")
+                {
+                    reader.readArray([&] { values.push_back(reader.readNumber()); });
+                }
+                else
+                {
+                    reader.skipValue();
+                }
+            });
+            auto& dst = out[id];
+            dst.insert(dst.end(), values.begin(), values.end());
+        });
+    });
+    return out;
+}
+
+auto getMedian(std::vector<double> x) -> double
+{
+    std::sort(x.begin(), x.end());
+    const std::size_t mid = x.size() / 2U;
+    return ((x.size() % 2U) != 0U) ? x.at(mid) : ((x.at(mid - 1U) + x.at(mid)) * 0.5);
+}
+
+/// The two-sided p-value of the Mann-Whitney U test. The exact null distribution of U is used for small samples
+/// without ties; otherwise, the normal approximation with the tie and continuity corrections is used.
+auto getMannWhitneyP(const std::vector<double>& a, const std::vector<double>& b) -> double
+{
+    const std::size_t n1 = a.size();
+    const std::size_t n2 = b.size();
+    // Rank the pooled samples, assigning the average rank to the ties.
+    std::vector<std::pair<double, bool>> pooled;
+    for (const double x : a)
+    {
+        pooled.emplace_back(x, true);
+    }
+    for (const double x : b)
+    {
+        pooled.emplace_back(x, false);
+    }
+    std::sort(pooled.begin(), pooled.end());
+    double rank_sum_a = 0;
+    double tie_term   = 0;
+    bool   has_ties   = false;
+    for (std::size_t i = 0; i < pooled.size();)
+    {
+        std::size_t j = i;
+        while ((j < pooled.size()) && (!(pooled.at(i).first < pooled.at(j).first)))
+        {
+            j++;
+        }
+        const auto   t    = static_cast<double>(j - i);
+        const double rank = static_cast<double>(i + j + 1U) * 0.5;  // The mean of the 1-based ranks i+1..j.
+        for (std::size_t k = i; k < j; k++)
+        {
+            rank_sum_a += pooled.at(k).second ? rank : 0.0;
+        }
+        tie_term += (t * t * t) - t;
+        has_ties = has_ties || (j > (i + 1U));
+        i        = j;
+    }
+    const auto   f1 = static_cast<double>(n1);
+    const auto   f2 = static_cast<double>(n2);
+    const double u  = rank_sum_a - ((f1 * (f1 + 1.0)) * 0.5);
+    const double mu = (f1 * f2) * 0.5;
+    if ((!has_ties) && ((n1 + n2) <= 50U))
+    {
+        // counts[i][j][v] is the number of arrangements of i and j samples with U = v, kept for the current i only.
+        const std::size_t                max_u = n1 * n2;
+        std::vector<std::vector<double>> prev(n2 + 1U, std::vector<double>(max_u + 1U, 0.0));
+        for (auto& row : prev)
+        {
+            row.at(0) = 1.0;  // With no samples in the first group, U is zero in the only arrangement.
+        }
+        for (std::size_t i = 1; i <= n1; i++)
+        {
+            std::vector<std::vector<double>> next(n2 + 1U, std::vector<double>(max_u + 1U, 0.0));
+            next.at(0).at(0) = 1.0;
+            for (std::size_t j = 1; j <= n2; j++)
+            {
+                for (std::size_t v = 0; v <= max_u; v++)
+                {
+                    // The largest value belongs either to the first group, adding j to U, or to the second one.
+                    next.at(j).at(v) = ((v >= j) ? prev.at(j).at(v - j) : 0.0) + next.at(j - 1U).at(v);
+                }
+            }
+            prev = std::move(next);
+        }
+        const std::vector<double>& counts = prev.at(n2);
+        double                     total  = 0;
+        double                     tail   = 0;
+        const double               dist   = std::abs(u - mu);
+        for (std::size_t v = 0; v <= max_u; v++)
+        {
+            total += counts.at(v);
+            tail += (std::abs(static_cast<double>(v) - mu) >= (dist - 1e-9)) ? counts.at(v) : 0.0;
+        }
+        return tail / total;
+    }
+    const double n     = f1 + f2;
+    const double sigma = std::sqrt(((f1 * f2) / 12.0) * ((n + 1.0) - (tie_term / (n * (n - 1.0)))));
+    if (!(sigma > 0.0))
+    {
+        return 1.0;
+    }
+    const double z = std::max(0.0, std::abs(u - mu) - 0.5) / sigma;
+    return std::erfc(z / std::sqrt(2.0));
+}
+
+}  // namespace
+
+int main(const int argc, const char* const argv[])
+{
+    const std::vector<std::string> args(argv, argv + argc);  // NOLINT(*-pointer-arithmetic)
+    if ((args.size() < 3U) || (args.size() > 5U))
+    {
+        (void) std::fprintf(stderr, "Usage: %s BASELINE.json CANDIDATE.json [threshold_percent [alpha]]\n", argv[0]);
+        return 2;
+    }
+    const double threshold = (args.size() > 3U) ? (std::atof(args.at(3).c_str()) / 100.0) : 0.05;  // NOLINT
+    const double alpha     = (args.size() > 4U) ? std::atof(args.at(4).c_str()) : 0.05;            // NOLINT
+    Samples      baseline;
+    Samples      candidate;
+    try
+    {
+        baseline  = load(args.at(1));
+        candidate = load(args.at(2));
+    } catch (const std::exception& ex)
+    {
+        (void) std::fprintf(stderr, "%s\n", ex.what());
+        return 2;
+    }
+
+    std::size_t regressions = 0;
+    std::printf("%-16s %-24s %-24s %-32s %12s %12s %8s %8s\n",
+                "verdict",
+                "scenario",
+                "variant",
+                "params",
+                "baseline",
+                "candidate",
+                "change",
+                "p");
+    for (const auto& [key, before] : baseline)
+    {
+        const auto it = candidate.find(key);
+        if ((it == candidate.end()) || before.empty() || it->second.empty())
+        {
+            continue;
+        }
+        const std::vector<double>& after   = it->second;
+        const double               m0      = getMedian(before);
+        const double               m1      = getMedian(after);
+        const double               change  = (m1 - m0) / m0;
+        const double               p       = getMannWhitneyP(before, after);
+        const char*                verdict = "~";
+        if (p < alpha)
+        {
+            if (change > threshold)
+            {
+                verdict = "REGRESSION";
+                regressions++;
+            }
+            else if (change < -threshold)
+            {
+                verdict = "improvement";
+            }
+            else
+            {
+                verdict = "minor";
+            }
+        }
+        std::printf("%-16s %-24s %-24s %-32s %12.2f %12.2f %+7.1f%% %8.4f\n",
+                    verdict,
+                    std::get<0>(key).c_str(),
+                    std::get<1>(key).c_str(),
+                    std::get<2>(key).c_str(),
+                    m0,
+                    m1,
+                    change * 100.0,
+                    p);
+    }
+    for (const auto& [key, samples] : candidate)
+    {
+        (void) samples;
+        if (baseline.count(key) == 0U)
+        {
+            std::printf("%-16s %-24s %-24s %-32s\n",
+                        "new",
+                        std::get<0>(key).c_str(),
+                        std::get<1>(key).c_str(),
+                        std::get<2>(key).c_str());
+        }
+    }
+    for (const auto& [key, samples] : baseline)
+    {
+        (void) samples;
+        if (candidate.count(key) == 0U)
+        {
+            std::printf("%-16s %-24s %-24s %-32s\n",
+                        "missing",
+                        std::get<0>(key).c_str(),
+                        std::get<1>(key).c_str(),
+                        std::get<2>(key).c_str());
+        }
+    }
+    std::printf("%zu regression(s) beyond %.1f%% at alpha=%.3f\n", regressions, threshold * 100.0, alpha);
+    return (regressions > 0U) ? 1 : 0;
+}